@@ -0,0 +1,865 @@
+#include "Benchmarks.hpp"
+#include "MemoryManager/PoolAllocator.hpp"
+#include "MemoryManager/StackAllocator.hpp"
+#include "MemoryManager/BuddyAllocator.hpp"
+#include "MemoryManager/StompAllocator.hpp"
+#include "MemoryManager/PolicyAllocator.hpp"
+#include "MemoryManager/TlsfAllocator.hpp"
+#include "MemoryManager/MemoryTrace.hpp"
+#include "MemoryManager/VirtualMemory.hpp"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <Windows.h>
+#include <psapi.h>
+#include <malloc.h>
+#else
+#include <malloc.h>
+#include <unistd.h>
+#endif
+
+/*
+* Compares the engine allocators with malloc on synthetic patterns (LIFO, FIFO, random size churn,
+* projectile bursts) and on traces recorded from the running game (see MemoryTrace.hpp).
+* Every workload is generated up front and replayed twice per backend: a timed pass for ns/op and
+* an untimed pass that samples the allocator footprint after each op.
+* Fragmentation is 1 - peak live requested bytes / peak footprint.
+* RSS growth is the highest resident set seen during the sampling pass minus the resident set
+* before its backend was created. Freed heap is handed back to the OS first so one backend's
+* leftovers do not hide the next one's growth.
+*/
+
+namespace
+{
+    constexpr size_t StompMaxOps = 20000;   // every stomp allocation is a few syscalls
+    constexpr size_t RssSampleInterval = 1024;  // reading the resident set is a syscall, not done every op
+
+    struct Op
+    {
+        uint32_t slot;
+        uint32_t size;
+        uint32_t alignment;
+        uint16_t arena;
+        MemoryTag tag;
+        bool alloc;
+    };
+
+    struct Workload
+    {
+        std::string name;
+        std::vector<Op> ops;
+        size_t slotCount = 0;
+        size_t maxSize = 0;
+        bool lifo = false;      // every free releases the newest live block
+    };
+
+    struct Result
+    {
+        std::string workload;
+        std::string backend;
+        size_t ops = 0;
+        size_t failures = 0;
+        double nsPerOp = 0.0;
+        size_t peakRequested = 0;
+        size_t peakFootprint = 0;
+        double fragmentation = 0.0;
+        size_t rssGrowth = 0;
+    };
+
+    size_t UsableSize(void* ptr)
+    {
+#ifdef _WIN32
+        return _msize(ptr);
+#else
+        return malloc_usable_size(ptr);
+#endif
+    }
+
+    size_t GetCurrentRss()
+    {
+#ifdef _WIN32
+        PROCESS_MEMORY_COUNTERS counters{};
+        if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+            return counters.WorkingSetSize;
+        return 0;
+#else
+        //Second field is resident pages
+        size_t totalPages = 0, residentPages = 0;
+        FILE* file = std::fopen("/proc/self/statm", "r");
+        if (!file)
+            return 0;
+        if (std::fscanf(file, "%zu %zu", &totalPages, &residentPages) != 2)
+            residentPages = 0;
+        std::fclose(file);
+        return residentPages * size_t(sysconf(_SC_PAGESIZE));
+#endif
+    }
+
+    void ReturnFreedHeap()
+    {
+#ifdef _WIN32
+        _heapmin();
+#else
+        malloc_trim(0);
+#endif
+    }
+
+    // ---- Backends ----
+
+    class Backend
+    {
+    public:
+        virtual ~Backend() = default;
+        virtual void* Allocate(const Op& op) = 0;
+        virtual void Free(const Op& op, void* ptr) = 0;
+        // Bytes the allocator holds for the live blocks, including its own rounding and headers
+        virtual size_t GetFootprint() const = 0;
+        virtual void EnableAccounting() {}
+    };
+
+    class MallocBackend : public Backend
+    {
+    public:
+        void* Allocate(const Op& op) override
+        {
+            void* ptr = std::malloc(op.size);
+            if (ptr && m_accounting)
+                m_usable += UsableSize(ptr);
+            return ptr;
+        }
+
+        void Free(const Op&, void* ptr) override
+        {
+            if (m_accounting)
+                m_usable -= UsableSize(ptr);
+            std::free(ptr);
+        }
+
+        size_t GetFootprint() const override { return m_usable; }
+        void EnableAccounting() override { m_accounting = true; }
+
+    private:
+        bool m_accounting = false;
+        size_t m_usable = 0;
+    };
+
+    class PoolBackend : public Backend
+    {
+    public:
+        explicit PoolBackend(size_t objectSize) : m_pool(objectSize, 256, 16) {}
+
+        void* Allocate(const Op&) override { return m_pool.Allocate(); }
+        void Free(const Op&, void* ptr) override { m_pool.Free(ptr); }
+
+        size_t GetFootprint() const override
+        {
+            PoolStats stats;
+            m_pool.GetStats(stats);
+            return stats.capacity * stats.objectSize;
+        }
+
+    private:
+        PoolAllocator m_pool;
+    };
+
+    class StackBackend : public Backend
+    {
+    public:
+        StackBackend() : m_stack(64 * 1024 * 1024, ArenaBacking::VirtualMemory, StackOverflowMode::ChainBlocks) {}
+
+        void* Allocate(const Op& op) override
+        {
+            m_markers.push_back(m_stack.GetMarker());
+            void* ptr = m_stack.Allocate(op.size, op.alignment);
+            if (!ptr)
+                m_markers.pop_back();
+            return ptr;
+        }
+
+        void Free(const Op&, void*) override
+        {
+            m_stack.FreeToMarker(m_markers.back());
+            m_markers.pop_back();
+        }
+
+        size_t GetFootprint() const override { return m_stack.GetUsed(); }
+
+    private:
+        StackAllocator m_stack;
+        std::vector<StackMarker> m_markers;
+    };
+
+    class BuddyBackend : public Backend
+    {
+    public:
+        BuddyBackend() : m_buddy(16, 256 * 1024 * 1024, ArenaBacking::VirtualMemory) {}
+
+        void* Allocate(const Op& op) override { return m_buddy.Allocate(op.size > op.alignment ? op.size : op.alignment); }
+        void Free(const Op&, void* ptr) override { m_buddy.Deallocate(ptr); }
+        size_t GetFootprint() const override { return m_buddy.GetAllocatedBytes(); }
+
+    private:
+        BuddyAllocator m_buddy;
+    };
+
+    // Buddy behind the policy wrapper, the release configuration should match the plain buddy
+    template<typename PolicyBuddy>
+    class PolicyBuddyBackend : public Backend
+    {
+    public:
+        PolicyBuddyBackend() : m_buddy(16, 256 * 1024 * 1024, ArenaBacking::VirtualMemory) {}
+
+        void* Allocate(const Op& op) override { return m_buddy.Allocate(op.size, op.alignment); }
+        void Free(const Op& op, void* ptr) override { m_buddy.Free(ptr, op.size); }
+        size_t GetFootprint() const override { return m_buddy.GetBacking().GetAllocatedBytes(); }
+
+    private:
+        PolicyBuddy m_buddy;
+    };
+
+    class TlsfBackend : public Backend
+    {
+    public:
+        TlsfBackend() : m_tlsf(256 * 1024 * 1024, ArenaBacking::VirtualMemory) {}
+
+        void* Allocate(const Op& op) override { return m_tlsf.Allocate(op.size); }
+        void Free(const Op&, void* ptr) override { m_tlsf.Deallocate(ptr); }
+        //Every block carries a 16 byte header
+        size_t GetFootprint() const override { return m_tlsf.GetAllocatedBytes() + m_tlsf.GetAllocationCount() * 16; }
+
+    private:
+        TlsfAllocator m_tlsf;
+    };
+
+    class StompBackend : public Backend
+    {
+    public:
+        explicit StompBackend(StompMode mode = StompMode::PerAllocation)
+            : m_stomp(mode), m_pageSize(VirtualMemory::GetPageSize()), m_extraPages(mode == StompMode::SlotRegion ? 1 : 2) {}
+
+        void* Allocate(const Op& op) override
+        {
+            void* ptr = m_stomp.allocate(op.size);
+            if (ptr)
+                m_footprint += PagesFor(op.size);
+            return ptr;
+        }
+
+        void Free(const Op& op, void* ptr) override
+        {
+            m_footprint -= PagesFor(op.size);
+            m_stomp.deallocate(ptr);
+        }
+
+        size_t GetFootprint() const override { return m_footprint; }
+
+    private:
+        //Data pages + guard page, per allocation mode adds the header page
+        size_t PagesFor(size_t size) const { return ((size + m_pageSize - 1) / m_pageSize + m_extraPages) * m_pageSize; }
+
+        StompAllocator m_stomp;
+        size_t m_pageSize;
+        size_t m_extraPages;
+        size_t m_footprint = 0;
+    };
+
+    // Trace replay with every recorded arena mapped back to the allocator kind it was recorded from
+    class EngineBackend : public Backend
+    {
+    public:
+        EngineBackend() = default;
+
+        void* Allocate(const Op& op) override
+        {
+            Arena& arena = GetArena(op);
+            switch (op.tag)
+            {
+            case MemoryTag::Pool:
+            case MemoryTag::SmallObject:
+                if (!arena.pool)
+                    arena.pool = std::make_unique<PoolAllocator>(op.size, 256, op.alignment ? op.alignment : 8);
+                if (op.size <= arena.pool->GetObjectSize())
+                    return arena.pool->Allocate();
+                return m_malloc.Allocate(op);
+            case MemoryTag::Stack:
+                if (!arena.stack)
+                    arena.stack = std::make_unique<StackBackend>();
+                return arena.stack->Allocate(op);
+            case MemoryTag::Buddy:
+                return m_buddy.Allocate(op);
+            case MemoryTag::Tlsf:
+                return m_tlsf.Allocate(op);
+            case MemoryTag::Stomp:
+                return m_stomp.Allocate(op);
+            default:
+                return m_malloc.Allocate(op);
+            }
+        }
+
+        void Free(const Op& op, void* ptr) override
+        {
+            Arena& arena = GetArena(op);
+            switch (op.tag)
+            {
+            case MemoryTag::Pool:
+            case MemoryTag::SmallObject:
+                if (arena.pool && op.size <= arena.pool->GetObjectSize())
+                    arena.pool->Free(ptr);
+                else
+                    m_malloc.Free(op, ptr);
+                break;
+            case MemoryTag::Stack:
+                arena.stack->Free(op, ptr);
+                break;
+            case MemoryTag::Buddy:
+                m_buddy.Free(op, ptr);
+                break;
+            case MemoryTag::Tlsf:
+                m_tlsf.Free(op, ptr);
+                break;
+            case MemoryTag::Stomp:
+                m_stomp.Free(op, ptr);
+                break;
+            default:
+                m_malloc.Free(op, ptr);
+                break;
+            }
+        }
+
+        size_t GetFootprint() const override
+        {
+            size_t footprint = m_malloc.GetFootprint() + m_buddy.GetFootprint() + m_tlsf.GetFootprint() + m_stomp.GetFootprint();
+            for (const Arena& arena : m_arenas)
+            {
+                if (arena.pool)
+                {
+                    PoolStats stats;
+                    arena.pool->GetStats(stats);
+                    footprint += stats.capacity * stats.objectSize;
+                }
+                if (arena.stack)
+                    footprint += arena.stack->GetFootprint();
+            }
+            return footprint;
+        }
+
+        void EnableAccounting() override { m_malloc.EnableAccounting(); }
+
+    private:
+        struct Arena
+        {
+            std::unique_ptr<PoolAllocator> pool;
+            std::unique_ptr<StackBackend> stack;
+        };
+
+        Arena& GetArena(const Op& op)
+        {
+            if (op.arena >= m_arenas.size())
+                m_arenas.resize(op.arena + 1);
+            return m_arenas[op.arena];
+        }
+
+        std::vector<Arena> m_arenas;
+        MallocBackend m_malloc;
+        BuddyBackend m_buddy;
+        TlsfBackend m_tlsf;
+        StompBackend m_stomp;
+    };
+
+    // ---- Workloads ----
+
+    Op MakeAlloc(uint32_t slot, uint32_t size, uint32_t alignment)
+    {
+        return Op{ slot, size, alignment, 0, MemoryTag::Pool, true };
+    }
+
+    Op MakeFree(const Op& alloc)
+    {
+        Op op = alloc;
+        op.alloc = false;
+        return op;
+    }
+
+    uint32_t RandomSize(std::mt19937& rng, uint32_t minSize, uint32_t maxSize)
+    {
+        return std::uniform_int_distribution<uint32_t>(minSize, maxSize)(rng);
+    }
+
+    // Mostly small sizes with a long tail, like mixed engine bookkeeping
+    uint32_t RandomChurnSize(std::mt19937& rng)
+    {
+        uint32_t base = 8u << std::uniform_int_distribution<uint32_t>(0, 9)(rng);
+        uint32_t size = base + std::uniform_int_distribution<uint32_t>(0, base - 1)(rng);
+        return size > 4096 ? 4096 : size;
+    }
+
+    Workload MakeLifo(size_t targetOps, uint32_t seed)
+    {
+        Workload w;
+        w.name = "lifo";
+        w.slotCount = 64;
+        w.lifo = true;
+
+        std::mt19937 rng(seed);
+        Op stack[64];
+        while (w.ops.size() < targetOps)
+        {
+            uint32_t depth = RandomSize(rng, 1, 64);
+            for (uint32_t i = 0; i < depth; ++i)
+            {
+                stack[i] = MakeAlloc(i, RandomSize(rng, 16, 256), (i & 1) ? 16 : 8);
+                w.ops.push_back(stack[i]);
+            }
+            for (uint32_t i = depth; i-- > 0;)
+                w.ops.push_back(MakeFree(stack[i]));
+        }
+        return w;
+    }
+
+    Workload MakeFifo(size_t targetOps, uint32_t seed)
+    {
+        Workload w;
+        w.name = "fifo";
+        w.slotCount = 1024;
+
+        std::mt19937 rng(seed);
+        std::vector<Op> ring(w.slotCount);
+        size_t oldest = 0;
+        for (uint32_t i = 0; i < w.slotCount; ++i)
+        {
+            ring[i] = MakeAlloc(i, RandomSize(rng, 16, 256), 8);
+            w.ops.push_back(ring[i]);
+        }
+
+        //Steady state, the oldest block goes and a new one takes its slot
+        while (w.ops.size() < targetOps)
+        {
+            w.ops.push_back(MakeFree(ring[oldest]));
+            ring[oldest] = MakeAlloc(uint32_t(oldest), RandomSize(rng, 16, 256), 8);
+            w.ops.push_back(ring[oldest]);
+            oldest = (oldest + 1) % w.slotCount;
+        }
+
+        for (size_t i = 0; i < w.slotCount; ++i)
+            w.ops.push_back(MakeFree(ring[(oldest + i) % w.slotCount]));
+        return w;
+    }
+
+    Workload MakeRandomChurn(size_t targetOps, uint32_t seed)
+    {
+        Workload w;
+        w.name = "random-churn";
+        w.slotCount = 4096;
+
+        std::mt19937 rng(seed);
+        std::vector<Op> live(w.slotCount);
+        std::vector<bool> used(w.slotCount, false);
+        std::uniform_int_distribution<uint32_t> pickSlot(0, uint32_t(w.slotCount - 1));
+
+        while (w.ops.size() < targetOps)
+        {
+            uint32_t slot = pickSlot(rng);
+            if (used[slot])
+            {
+                w.ops.push_back(MakeFree(live[slot]));
+                used[slot] = false;
+            }
+            else
+            {
+                live[slot] = MakeAlloc(slot, RandomChurnSize(rng), 8);
+                w.ops.push_back(live[slot]);
+                used[slot] = true;
+            }
+        }
+
+        for (uint32_t slot = 0; slot < w.slotCount; ++slot)
+        {
+            if (used[slot])
+                w.ops.push_back(MakeFree(live[slot]));
+        }
+        return w;
+    }
+
+    // Mirrors ProjectileManager: fixed size objects, a volley every half second, swap-remove on death
+    Workload MakeProjectileBursts(size_t targetOps, uint32_t seed)
+    {
+        constexpr uint32_t ProjectileSize = 96;
+
+        Workload w;
+        w.name = "projectile-bursts";
+        w.slotCount = 8192;
+
+        struct Live
+        {
+            Op op;
+            uint32_t framesLeft;
+        };
+
+        std::mt19937 rng(seed);
+        std::vector<Live> alive;
+        std::vector<uint32_t> freeSlots;
+        for (uint32_t slot = uint32_t(w.slotCount); slot-- > 0;)
+            freeSlots.push_back(slot);
+
+        for (uint32_t frame = 0; w.ops.size() < targetOps; ++frame)
+        {
+            uint32_t spawns = (frame % 30 == 0) ? RandomSize(rng, 100, 300) : RandomSize(rng, 0, 3);
+            for (uint32_t i = 0; i < spawns && !freeSlots.empty(); ++i)
+            {
+                Live projectile{ MakeAlloc(freeSlots.back(), ProjectileSize, 16), RandomSize(rng, 30, 300) };
+                freeSlots.pop_back();
+                w.ops.push_back(projectile.op);
+                alive.push_back(projectile);
+            }
+
+            for (size_t i = 0; i < alive.size();)
+            {
+                if (--alive[i].framesLeft == 0)
+                {
+                    w.ops.push_back(MakeFree(alive[i].op));
+                    freeSlots.push_back(alive[i].op.slot);
+                    alive[i] = alive.back();
+                    alive.pop_back();
+                }
+                else
+                {
+                    ++i;
+                }
+            }
+        }
+
+        for (const Live& projectile : alive)
+            w.ops.push_back(MakeFree(projectile.op));
+        return w;
+    }
+
+    // Payload buffers of the shipped assets: RGBA8 pixels of every texture in Project/Assets and the
+    // position/normal/texcoord arrays tinyobjToRaylib builds for every mesh (vertex count * 12/12/8 bytes)
+    const uint32_t AssetPayloadSizes[] =
+    {
+        4194304, 129600, 548460, 1048576, 9000000, 562000, 2252000,   // Noise, Portman_v1_big, Toe, colormap, plastic_high/low/medium
+        432, 432, 288,                  // cube (36 vertices)
+        7776, 7776, 5184,               // snow-flat-large (648)
+        9504, 9504, 6336,               // snow-pile (792)
+        39960, 39960, 26640,            // snowman-hat (3330)
+        27216, 27216, 18144,            // tree-snow-a (2268)
+        26928, 26928, 17952,            // tree-snow-b (2244)
+        16848, 16848, 11232,            // tree (1404)
+    };
+
+    // Streaming: a fixed number of resident payloads, a random one is unloaded and another asset loaded in its place
+    Workload MakeAssetPayloads(size_t targetOps, uint32_t seed)
+    {
+        Workload w;
+        w.name = "asset-payloads";
+        w.slotCount = 12;
+
+        std::mt19937 rng(seed);
+        std::uniform_int_distribution<size_t> pickAsset(0, sizeof(AssetPayloadSizes) / sizeof(AssetPayloadSizes[0]) - 1);
+        std::uniform_int_distribution<uint32_t> pickSlot(0, uint32_t(w.slotCount - 1));
+
+        std::vector<Op> resident(w.slotCount);
+        for (uint32_t slot = 0; slot < w.slotCount; ++slot)
+        {
+            resident[slot] = MakeAlloc(slot, AssetPayloadSizes[pickAsset(rng)], 16);
+            resident[slot].tag = MemoryTag::ResourcePayload;
+            w.ops.push_back(resident[slot]);
+        }
+
+        while (w.ops.size() < targetOps)
+        {
+            uint32_t slot = pickSlot(rng);
+            w.ops.push_back(MakeFree(resident[slot]));
+            resident[slot] = MakeAlloc(slot, AssetPayloadSizes[pickAsset(rng)], 16);
+            resident[slot].tag = MemoryTag::ResourcePayload;
+            w.ops.push_back(resident[slot]);
+        }
+
+        for (const Op& op : resident)
+            w.ops.push_back(MakeFree(op));
+        return w;
+    }
+
+    bool MakeTraceWorkload(const char* path, Workload& outWorkload)
+    {
+        std::vector<MemoryTraceEvent> events;
+        if (!LoadMemoryTrace(path, events))
+            return false;
+
+        outWorkload.name = std::string("trace:") + path;
+        outWorkload.ops.reserve(events.size());
+
+        std::unordered_map<uint32_t, Op> liveById;
+        std::vector<uint32_t> freeSlots;
+        uint32_t nextSlot = 0;
+
+        for (const MemoryTraceEvent& event : events)
+        {
+            if (event.op == MemoryTraceOp::Alloc)
+            {
+                uint32_t slot;
+                if (!freeSlots.empty())
+                {
+                    slot = freeSlots.back();
+                    freeSlots.pop_back();
+                }
+                else
+                {
+                    slot = nextSlot++;
+                }
+
+                Op op{ slot, uint32_t(event.size), event.alignment ? event.alignment : 8, event.arena, event.tag, true };
+                liveById[event.id] = op;
+                outWorkload.ops.push_back(op);
+                if (op.size > outWorkload.maxSize)
+                    outWorkload.maxSize = op.size;
+            }
+            else
+            {
+                auto it = liveById.find(event.id);
+                if (it == liveById.end())
+                    continue;
+
+                outWorkload.ops.push_back(MakeFree(it->second));
+                freeSlots.push_back(it->second.slot);
+                liveById.erase(it);
+            }
+        }
+
+        //Blocks still live when the trace stopped are released after the timed pass
+        outWorkload.slotCount = nextSlot;
+        return true;
+    }
+
+    size_t MaxSize(const Workload& w)
+    {
+        size_t maxSize = 0;
+        for (const Op& op : w.ops)
+        {
+            if (op.size > maxSize)
+                maxSize = op.size;
+        }
+        return maxSize;
+    }
+
+    // ---- Runner ----
+
+    // Returns failed allocations, leftovers are freed after the (timed) loop
+    size_t Replay(Backend& backend, const Workload& w, size_t opCount, bool sampleFootprint,
+        size_t& outPeakRequested, size_t& outPeakFootprint, size_t& outPeakRss)
+    {
+        std::vector<void*> slots(w.slotCount, nullptr);
+        std::vector<Op> slotOps(w.slotCount);
+        size_t failures = 0;
+        size_t requested = 0;
+
+        for (size_t i = 0; i < opCount; ++i)
+        {
+            const Op& op = w.ops[i];
+            if (op.alloc)
+            {
+                void* ptr = backend.Allocate(op);
+                slots[op.slot] = ptr;
+                slotOps[op.slot] = op;
+                if (!ptr)
+                {
+                    ++failures;
+                    continue;
+                }
+                if (sampleFootprint)
+                    requested += op.size;
+            }
+            else
+            {
+                void* ptr = slots[op.slot];
+                if (!ptr)
+                    continue;
+                backend.Free(op, ptr);
+                slots[op.slot] = nullptr;
+                if (sampleFootprint)
+                    requested -= op.size;
+            }
+
+            if (sampleFootprint)
+            {
+                if (i % RssSampleInterval == 0 || i + 1 == opCount)
+                {
+                    size_t rss = GetCurrentRss();
+                    if (rss > outPeakRss)
+                        outPeakRss = rss;
+                }
+
+                size_t footprint = backend.GetFootprint();
+                if (footprint > outPeakFootprint)
+                    outPeakFootprint = footprint;
+                if (requested > outPeakRequested)
+                    outPeakRequested = requested;
+            }
+        }
+
+        //Newest first so stack arenas can rewind
+        for (size_t slot = w.slotCount; slot-- > 0;)
+        {
+            if (slots[slot])
+                backend.Free(slotOps[slot], slots[slot]);
+        }
+        return failures;
+    }
+
+    template<typename CreateBackend>
+    Result Run(const Workload& w, const char* backendName, size_t opLimit, CreateBackend create)
+    {
+        Result result;
+        result.workload = w.name;
+        result.backend = backendName;
+        result.ops = w.ops.size() < opLimit ? w.ops.size() : opLimit;
+
+        size_t unusedRequested = 0, unusedFootprint = 0, unusedRss = 0;
+        {
+            std::unique_ptr<Backend> backend = create();
+            auto start = std::chrono::steady_clock::now();
+            result.failures = Replay(*backend, w, result.ops, false, unusedRequested, unusedFootprint, unusedRss);
+            auto end = std::chrono::steady_clock::now();
+            result.nsPerOp = std::chrono::duration<double, std::nano>(end - start).count() / double(result.ops ? result.ops : 1);
+        }
+        {
+            ReturnFreedHeap();
+            size_t baselineRss = GetCurrentRss();
+            size_t peakRss = baselineRss;
+
+            std::unique_ptr<Backend> backend = create();
+            backend->EnableAccounting();
+            Replay(*backend, w, result.ops, true, result.peakRequested, result.peakFootprint, peakRss);
+            result.rssGrowth = peakRss - baselineRss;
+        }
+
+        if (result.peakFootprint > 0)
+            result.fragmentation = 1.0 - double(result.peakRequested) / double(result.peakFootprint);
+        return result;
+    }
+
+    void RunWorkload(const Workload& w, bool isTrace, std::vector<Result>& outResults)
+    {
+        size_t maxSize = w.maxSize ? w.maxSize : MaxSize(w);
+
+        outResults.push_back(Run(w, "malloc", SIZE_MAX, []() { return std::make_unique<MallocBackend>(); }));
+        if (isTrace)
+        {
+            outResults.push_back(Run(w, "engine", SIZE_MAX, []() { return std::make_unique<EngineBackend>(); }));
+        }
+        else
+        {
+            //A pool sized for multi-megabyte payloads would reserve gigabytes per chunk
+            if (maxSize <= 64 * 1024)
+                outResults.push_back(Run(w, "pool", SIZE_MAX, [maxSize]() { return std::make_unique<PoolBackend>(maxSize); }));
+            if (w.lifo)
+                outResults.push_back(Run(w, "stack", SIZE_MAX, []() { return std::make_unique<StackBackend>(); }));
+        }
+        outResults.push_back(Run(w, "buddy", SIZE_MAX, []() { return std::make_unique<BuddyBackend>(); }));
+        outResults.push_back(Run(w, "buddy-release", SIZE_MAX, []() { return std::make_unique<PolicyBuddyBackend<ReleaseAllocator<BuddyAllocator>>>(); }));
+        outResults.push_back(Run(w, "buddy-debug", SIZE_MAX, []() { return std::make_unique<PolicyBuddyBackend<DebugAllocator<BuddyAllocator>>>(); }));
+        outResults.push_back(Run(w, "tlsf", SIZE_MAX, []() { return std::make_unique<TlsfBackend>(); }));
+        if (!isTrace)
+        {
+            outResults.push_back(Run(w, "stomp", StompMaxOps, []() { return std::make_unique<StompBackend>(); }));
+            outResults.push_back(Run(w, "stomp-region", StompMaxOps, []() { return std::make_unique<StompBackend>(StompMode::SlotRegion); }));
+        }
+    }
+
+    void WriteJsonString(FILE* file, const std::string& text)
+    {
+        std::fputc('"', file);
+        for (char c : text)
+        {
+            if (c == '"' || c == '\\')
+                std::fputc('\\', file);
+            std::fputc(c, file);
+        }
+        std::fputc('"', file);
+    }
+
+    bool WriteJson(const char* path, const std::vector<Result>& results)
+    {
+        FILE* file = std::fopen(path, "w");
+        if (!file)
+        {
+            std::fprintf(stderr, "Could not write %s\n", path);
+            return false;
+        }
+
+        std::fprintf(file, "{\n  \"benchmark\": \"allocators\",\n  \"results\": [\n");
+        for (size_t i = 0; i < results.size(); ++i)
+        {
+            const Result& r = results[i];
+            std::fprintf(file, "    { \"workload\": ");
+            WriteJsonString(file, r.workload);
+            std::fprintf(file, ", \"backend\": ");
+            WriteJsonString(file, r.backend);
+            std::fprintf(file, ", \"ops\": %zu, \"failures\": %zu, \"nsPerOp\": %.3f, \"peakRequestedBytes\": %zu, "
+                "\"peakFootprintBytes\": %zu, \"fragmentation\": %.4f, \"rssGrowthBytes\": %zu }%s\n",
+                r.ops, r.failures, r.nsPerOp, r.peakRequested, r.peakFootprint, r.fragmentation, r.rssGrowth,
+                i + 1 < results.size() ? "," : "");
+        }
+        std::fprintf(file, "  ]\n}\n");
+        std::fclose(file);
+        return true;
+    }
+}
+
+int RunAllocatorBenchmark(int argc, char** argv)
+{
+    size_t ops = 200000;
+    uint32_t seed = 1234;
+    const char* tracePath = nullptr;
+    const char* jsonPath = nullptr;
+
+    for (int i = 0; i + 1 < argc; ++i)
+    {
+        if (std::strcmp(argv[i], "--ops") == 0)
+            ops = std::strtoull(argv[i + 1], nullptr, 10);
+        else if (std::strcmp(argv[i], "--seed") == 0)
+            seed = uint32_t(std::strtoul(argv[i + 1], nullptr, 10));
+        else if (std::strcmp(argv[i], "--trace") == 0)
+            tracePath = argv[i + 1];
+        else if (std::strcmp(argv[i], "--json") == 0)
+            jsonPath = argv[i + 1];
+    }
+
+    std::vector<Result> results;
+    RunWorkload(MakeLifo(ops, seed), false, results);
+    RunWorkload(MakeFifo(ops, seed), false, results);
+    RunWorkload(MakeRandomChurn(ops, seed), false, results);
+    RunWorkload(MakeProjectileBursts(ops, seed), false, results);
+    RunWorkload(MakeAssetPayloads(ops, seed), false, results);
+
+    if (tracePath)
+    {
+        Workload trace;
+        if (!MakeTraceWorkload(tracePath, trace))
+            return 1;
+        RunWorkload(trace, true, results);
+    }
+
+    std::printf("%-20s %-12s %10s %10s %8s %14s\n", "workload", "backend", "ops", "ns/op", "frag", "RSS growth MB");
+    for (const Result& r : results)
+    {
+        std::printf("%-20s %-12s %10zu %10.2f %7.1f%% %14.1f", r.workload.c_str(), r.backend.c_str(),
+            r.ops, r.nsPerOp, r.fragmentation * 100.0, r.rssGrowth / (1024.0 * 1024.0));
+        if (r.failures)
+            std::printf("  (%zu failed)", r.failures);
+        std::printf("\n");
+    }
+
+    if (jsonPath && !WriteJson(jsonPath, results))
+        return 1;
+    return 0;
+}
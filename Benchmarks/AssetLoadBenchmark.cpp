@@ -0,0 +1,171 @@
+#include "Benchmarks.hpp"
+#include "AssetManager/AssetManager.hpp"
+#include "AssetManager/PackagingTool.hpp"
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+/*
+* Asset loads through AssetManager at 1..N loader workers.
+* A bundle of generated OBJ meshes is packed with PackagingTool into a temp directory, then every
+* run makes a fresh AssetManager on it, queues all assets with LoadAsync and waits until the queue
+* drains. So the numbers include the whole loader path: scheduling, TOC lookup, LZ decompression
+* and the tinyobj parse of MeshObj. Debug builds sleep in every job, measure a release build.
+*/
+
+namespace
+{
+    // Grid meshes in the size range of the game's OBJs, from a few KB to a few hundred
+    const uint32_t GridSizes[] = { 4, 8, 12, 16, 24, 32, 48, 64, 96, 128 };
+
+    void WriteGridObj(const std::filesystem::path& path, uint32_t grid, std::mt19937& rng)
+    {
+        std::uniform_real_distribution<float> height(-0.5f, 0.5f);
+        std::ofstream file(path);
+        char line[256];
+
+        for (uint32_t z = 0; z <= grid; ++z)
+        {
+            for (uint32_t x = 0; x <= grid; ++x)
+            {
+                std::snprintf(line, sizeof(line), "v %.6f %.6f %.6f\nvt %.6f %.6f\nvn 0.0 1.0 0.0\n",
+                    float(x), height(rng), float(z), float(x) / float(grid), float(z) / float(grid));
+                file << line;
+            }
+        }
+
+        //Two triangles per quad, OBJ indices start at 1
+        for (uint32_t z = 0; z < grid; ++z)
+        {
+            for (uint32_t x = 0; x < grid; ++x)
+            {
+                uint32_t a = z * (grid + 1) + x + 1;
+                uint32_t b = a + 1;
+                uint32_t c = a + grid + 1;
+                uint32_t d = c + 1;
+                std::snprintf(line, sizeof(line), "f %u/%u/1 %u/%u/1 %u/%u/1\nf %u/%u/1 %u/%u/1 %u/%u/1\n",
+                    a, a, c, c, b, b, b, b, c, c, d, d);
+                file << line;
+            }
+        }
+    }
+
+    // Every asset gets its own id, the meshes behind them repeat
+    bool WriteBundle(const std::filesystem::path& directory, const std::string& bundlePath, size_t assetCount, uint32_t seed)
+    {
+        std::mt19937 rng(seed);
+        std::vector<std::string> meshes;
+        for (uint32_t grid : GridSizes)
+        {
+            std::filesystem::path path = directory / ("grid" + std::to_string(grid) + ".obj");
+            WriteGridObj(path, grid, rng);
+            meshes.push_back(path.string());
+        }
+
+        std::string listPath = (directory / "assets.txt").string();
+        {
+            std::ofstream list(listPath);
+            for (size_t i = 0; i < assetCount; ++i)
+                list << "bench_" << i << "," << meshes[rng() % meshes.size()] << ",Mesh\n";
+        }
+
+        PackagingTool packagingTool;
+        return packagingTool.buildPackage(listPath, bundlePath);
+    }
+
+    struct LoadResult
+    {
+        double seconds = 0.0;
+        size_t loaded = 0;
+    };
+
+    LoadResult RunLoads(const std::string& bundlePath, const std::vector<AssetId>& ids, size_t workerCount)
+    {
+        //Big enough that nothing is evicted, only loading is measured
+        AssetManager assetManager(size_t(1) << 40, bundlePath, GetSmallObjectResource(), workerCount);
+        AssetManagerDebugInfo info;
+
+        LoadResult result;
+        auto start = std::chrono::steady_clock::now();
+        for (AssetId id : ids)
+            assetManager.LoadAsync(id);
+
+        for (;;)
+        {
+            assetManager.GetDebugInfo(info);
+            if (info.asyncQueuedJobs + info.asyncActiveJobs == 0)
+                break;
+            std::this_thread::sleep_for(std::chrono::microseconds(200));
+        }
+        auto end = std::chrono::steady_clock::now();
+
+        result.seconds = std::chrono::duration<double>(end - start).count();
+        result.loaded = info.loadedResourceCount;
+        return result;
+    }
+}
+
+int RunAssetLoadBenchmark(int argc, char** argv)
+{
+    size_t assetCount = 400;
+    size_t maxWorkers = std::thread::hardware_concurrency();
+    uint32_t seed = 1;
+    for (int i = 0; i + 1 < argc; ++i)
+    {
+        if (std::strcmp(argv[i], "--assets") == 0)
+            assetCount = std::strtoull(argv[i + 1], nullptr, 10);
+        else if (std::strcmp(argv[i], "--workers") == 0)
+            maxWorkers = std::strtoull(argv[i + 1], nullptr, 10);
+        else if (std::strcmp(argv[i], "--seed") == 0)
+            seed = uint32_t(std::strtoul(argv[i + 1], nullptr, 10));
+    }
+    if (maxWorkers == 0)
+        maxWorkers = 1;
+
+    std::filesystem::path directory = std::filesystem::temp_directory_path() / "asset_load_benchmark";
+    std::filesystem::create_directories(directory);
+    std::string bundlePath = (directory / "bench.bundle").string();
+    if (!WriteBundle(directory, bundlePath, assetCount, seed))
+    {
+        std::filesystem::remove_all(directory);
+        return 1;
+    }
+
+    std::vector<AssetId> ids;
+    for (size_t i = 0; i < assetCount; ++i)
+        ids.push_back(AssetId("bench_" + std::to_string(i)));
+
+    std::vector<size_t> workerCounts;
+    for (size_t workers = 1; workers < maxWorkers; workers *= 2)
+        workerCounts.push_back(workers);
+    workerCounts.push_back(maxWorkers);
+
+    std::printf("%-8s %12s %10s\n", "workers", "assets/s", "speedup");
+    double baseline = 0.0;
+    int status = 0;
+    for (size_t workers : workerCounts)
+    {
+        LoadResult result = RunLoads(bundlePath, ids, workers);
+        double perSecond = double(assetCount) / result.seconds;
+        if (baseline == 0.0)
+            baseline = perSecond;
+
+        std::printf("%-8zu %12.1f %9.2fx\n", workers, perSecond, perSecond / baseline);
+        if (result.loaded != assetCount)
+        {
+            std::printf("  warning: %zu of %zu assets loaded\n", result.loaded, assetCount);
+            status = 1;
+        }
+    }
+
+    std::filesystem::remove_all(directory);
+    return status;
+}
@@ -0,0 +1,10 @@
+#pragma once
+
+// Every benchmark prints a human readable table to stdout and returns 0 on success
+int RunPoolContentionBenchmark(int argc, char** argv);
+// --ops N --seed S --trace file --json file
+int RunAllocatorBenchmark(int argc, char** argv);
+// --assets N --workers N --seed S
+int RunAssetLoadBenchmark(int argc, char** argv);
+// --size bytes --iterations N --workers N --seed S --file path
+int RunCompressionBenchmark(int argc, char** argv);
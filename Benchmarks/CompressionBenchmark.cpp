@@ -0,0 +1,187 @@
+#include "Benchmarks.hpp"
+#include "AssetManager/LzCodec.hpp"
+#include "AssetManager/WorkerPool.hpp"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <mutex>
+#include <random>
+#include <string>
+#include <vector>
+
+/*
+* LzCodec throughput on the kind of payloads the bundle holds.
+* "obj" is generated Wavefront text like the meshes, "random" stands in for PNGs that do not
+* compress, --file adds a real asset. Each input is cut into asset sized blocks compressed on
+* their own like PackagingTool does. Compress and decompress run on one thread, "pool" decodes
+* all blocks in parallel on a WorkerPool, like the asset loader threads. MB/s is of uncompressed bytes.
+*/
+
+namespace
+{
+    constexpr size_t BlockSize = 256 * 1024;
+
+    struct Block
+    {
+        size_t offset;
+        size_t size;
+        std::vector<uint8_t> compressed;
+    };
+
+    std::vector<uint8_t> GenerateObj(size_t size, uint32_t seed)
+    {
+        std::mt19937 rng(seed);
+        std::uniform_real_distribution<float> position(-10.0f, 10.0f);
+        std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+        std::string text = "# generated\no mesh\n";
+        char line[512];
+
+        for (size_t vertex = 1; text.size() < size; ++vertex)
+        {
+            std::snprintf(line, sizeof(line), "v %.6f %.6f %.6f\nvt %.6f %.6f\nvn %.4f %.4f %.4f\n",
+                position(rng), position(rng), position(rng), unit(rng), unit(rng), unit(rng), unit(rng), unit(rng));
+            text += line;
+            if (vertex >= 3)
+            {
+                std::snprintf(line, sizeof(line), "f %zu/%zu/%zu %zu/%zu/%zu %zu/%zu/%zu\n",
+                    vertex - 2, vertex - 2, vertex - 2, vertex - 1, vertex - 1, vertex - 1, vertex, vertex, vertex);
+                text += line;
+            }
+        }
+        text.resize(size);
+        return std::vector<uint8_t>(text.begin(), text.end());
+    }
+
+    std::vector<uint8_t> GenerateRandom(size_t size, uint32_t seed)
+    {
+        std::mt19937 rng(seed);
+        std::vector<uint8_t> bytes(size);
+        for (uint8_t& byte : bytes)
+            byte = static_cast<uint8_t>(rng());
+        return bytes;
+    }
+
+    double MegabytesPerSecond(size_t bytes, std::chrono::steady_clock::duration elapsed)
+    {
+        return double(bytes) / (1024.0 * 1024.0) / std::chrono::duration<double>(elapsed).count();
+    }
+
+    // Returns false if a block does not decode back to the input
+    bool RunInput(const char* name, const std::vector<uint8_t>& input, size_t iterations, size_t workerCount)
+    {
+        std::vector<Block> blocks;
+        for (size_t offset = 0; offset < input.size(); offset += BlockSize)
+            blocks.push_back({ offset, std::min(BlockSize, input.size() - offset), {} });
+
+        size_t compressedBytes = 0;
+        auto start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < iterations; ++i)
+        {
+            compressedBytes = 0;
+            for (Block& block : blocks)
+            {
+                block.compressed.resize(LzCompressBound(block.size));
+                size_t size = LzCompress(ByteSpan{ input.data() + block.offset, block.size }, block.compressed.data(), block.compressed.size());
+                block.compressed.resize(size);
+                compressedBytes += size;
+            }
+        }
+        double compressSpeed = MegabytesPerSecond(input.size() * iterations, std::chrono::steady_clock::now() - start);
+
+        std::vector<uint8_t> output(input.size());
+        bool valid = true;
+        start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < iterations; ++i)
+        {
+            for (const Block& block : blocks)
+                valid &= LzDecompress(ByteSpan{ block.compressed.data(), block.compressed.size() }, output.data() + block.offset, block.size);
+        }
+        double decompressSpeed = MegabytesPerSecond(input.size() * iterations, std::chrono::steady_clock::now() - start);
+        valid = valid && output == input;
+
+        //Every block once per iteration, each job owns its part of output so nothing is shared
+        std::mutex doneMutex;
+        std::condition_variable doneSignal;
+        size_t done = 0;
+        const size_t jobCount = blocks.size() * iterations;
+        std::atomic<bool> poolValid{ true };
+
+        start = std::chrono::steady_clock::now();
+        {
+            WorkerPool<size_t> pool(workerCount, [&](size_t& index)
+            {
+                const Block& block = blocks[index];
+                if (!LzDecompress(ByteSpan{ block.compressed.data(), block.compressed.size() }, output.data() + block.offset, block.size))
+                    poolValid.store(false, std::memory_order_relaxed);
+
+                std::scoped_lock lock(doneMutex);
+                if (++done == jobCount)
+                    doneSignal.notify_one();
+            });
+
+            for (size_t i = 0; i < jobCount; ++i)
+                pool.Submit(i % blocks.size());
+
+            std::unique_lock lock(doneMutex);
+            doneSignal.wait(lock, [&]() { return done == jobCount; });
+        }
+        double poolSpeed = MegabytesPerSecond(input.size() * iterations, std::chrono::steady_clock::now() - start);
+        valid = valid && poolValid.load();
+
+        std::printf("%-10s %10zu %8.1f%% %14.1f %16.1f %12.1f\n", name, input.size(),
+            100.0 * double(compressedBytes) / double(input.size()), compressSpeed, decompressSpeed, poolSpeed);
+        if (!valid)
+            std::printf("  error: %s did not decode back to the input\n", name);
+        return valid;
+    }
+}
+
+int RunCompressionBenchmark(int argc, char** argv)
+{
+    size_t size = 8 * 1024 * 1024;
+    size_t iterations = 4;
+    size_t workers = 0;
+    uint32_t seed = 1;
+    const char* path = nullptr;
+    for (int i = 0; i + 1 < argc; ++i)
+    {
+        if (std::strcmp(argv[i], "--size") == 0)
+            size = std::strtoull(argv[i + 1], nullptr, 10);
+        else if (std::strcmp(argv[i], "--iterations") == 0)
+            iterations = std::strtoull(argv[i + 1], nullptr, 10);
+        else if (std::strcmp(argv[i], "--workers") == 0)
+            workers = std::strtoull(argv[i + 1], nullptr, 10);
+        else if (std::strcmp(argv[i], "--seed") == 0)
+            seed = uint32_t(std::strtoul(argv[i + 1], nullptr, 10));
+        else if (std::strcmp(argv[i], "--file") == 0)
+            path = argv[i + 1];
+    }
+    if (iterations == 0)
+        iterations = 1;
+    if (workers == 0)
+        workers = WorkerPool<size_t>::DefaultWorkerCount();
+
+    std::printf("%-10s %10s %9s %14s %16s %12s\n", "input", "bytes", "ratio", "compress MB/s", "decompress MB/s", "pool MB/s");
+    bool valid = RunInput("obj", GenerateObj(size, seed), iterations, workers);
+    valid &= RunInput("random", GenerateRandom(size, seed), iterations, workers);
+
+    if (path)
+    {
+        std::ifstream file(path, std::ios::binary);
+        if (!file)
+        {
+            std::printf("  error: could not open %s\n", path);
+            return 1;
+        }
+        std::vector<uint8_t> bytes((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+        valid &= RunInput("file", bytes, iterations, workers);
+    }
+
+    return valid ? 0 : 1;
+}
@@ -0,0 +1,115 @@
+#include "Benchmarks.hpp"
+#include "MemoryManager/ConcurrentPoolAllocator.hpp"
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+/*
+* Every thread repeatedly allocates a batch of projectile sized objects, touches them
+* and frees them again. Runs the thread-safe pool and malloc at 1..32 threads.
+*/
+
+namespace
+{
+    constexpr size_t ObjectSize = 64;
+    constexpr size_t BatchSize = 64;
+
+    struct MallocBackend
+    {
+        void* Allocate() { return std::malloc(ObjectSize); }
+        void Free(void* ptr) { std::free(ptr); }
+        void Flush() {}
+    };
+
+    struct PoolBackend
+    {
+        ConcurrentPoolAllocator& pool;
+        void* Allocate() { return pool.Allocate(); }
+        void Free(void* ptr) { pool.Free(ptr); }
+        void Flush() { pool.FlushThreadCache(); }
+    };
+
+    template<typename Backend>
+    double RunThreads(Backend backend, int threadCount, size_t rounds)
+    {
+        std::atomic<int> ready{ 0 };
+        std::atomic<bool> go{ false };
+        std::atomic<size_t> failures{ 0 };
+        std::vector<std::thread> threads;
+
+        for (int t = 0; t < threadCount; ++t)
+        {
+            threads.emplace_back([&, t]()
+            {
+                void* batch[BatchSize];
+                ready.fetch_add(1);
+                while (!go.load(std::memory_order_acquire)) {}
+
+                for (size_t r = 0; r < rounds; ++r)
+                {
+                    for (size_t i = 0; i < BatchSize; ++i)
+                    {
+                        batch[i] = backend.Allocate();
+                        if (batch[i])
+                            std::memset(batch[i], t, 8);
+                        else
+                            failures.fetch_add(1, std::memory_order_relaxed);
+                    }
+
+                    //Free every other block first so the free order differs from the allocation order
+                    for (size_t i = 0; i < BatchSize; i += 2)
+                        backend.Free(batch[i]);
+                    for (size_t i = 1; i < BatchSize; i += 2)
+                        backend.Free(batch[i]);
+                }
+                backend.Flush();
+            });
+        }
+
+        while (ready.load() != threadCount) {}
+        auto start = std::chrono::steady_clock::now();
+        go.store(true, std::memory_order_release);
+
+        for (std::thread& thread : threads)
+            thread.join();
+        auto end = std::chrono::steady_clock::now();
+
+        if (failures.load() != 0)
+            std::printf("  warning: %zu allocations failed\n", failures.load());
+
+        double totalOps = double(threadCount) * double(rounds) * BatchSize * 2.0;
+        double ns = std::chrono::duration<double, std::nano>(end - start).count();
+        return ns / totalOps;
+    }
+}
+
+int RunPoolContentionBenchmark(int argc, char** argv)
+{
+    size_t rounds = 20000;
+    for (int i = 0; i + 1 < argc; ++i)
+    {
+        if (std::strcmp(argv[i], "--rounds") == 0)
+            rounds = std::strtoull(argv[i + 1], nullptr, 10);
+    }
+
+    const int threadCounts[] = { 1, 2, 4, 8, 16, 32 };
+
+    std::printf("%-8s %14s %14s %10s\n", "threads", "pool ns/op", "malloc ns/op", "speedup");
+    for (int threads : threadCounts)
+    {
+        //Room for every thread's live batch plus the blocks parked in magazines
+        size_t capacity = size_t(threads) * (BatchSize + ConcurrentPoolAllocator::MagazineSize) + 1024;
+        ConcurrentPoolAllocator pool(ObjectSize, capacity, alignof(std::max_align_t));
+
+        double poolNs = RunThreads(PoolBackend{ pool }, threads, rounds);
+        double mallocNs = RunThreads(MallocBackend{}, threads, rounds);
+
+        std::printf("%-8d %14.2f %14.2f %9.2fx\n", threads, poolNs, mallocNs, mallocNs / poolNs);
+    }
+
+    return 0;
+}
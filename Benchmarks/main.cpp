@@ -0,0 +1,51 @@
+#include "Benchmarks.hpp"
+#include <cstring>
+#include <iostream>
+
+struct BenchmarkEntry
+{
+    const char* name;
+    int (*run)(int argc, char** argv);
+};
+
+static const BenchmarkEntry g_benchmarks[] =
+{
+    { "pool-contention", RunPoolContentionBenchmark },
+    { "allocators", RunAllocatorBenchmark },
+    { "asset-loads", RunAssetLoadBenchmark },
+    { "lz-codec", RunCompressionBenchmark },
+};
+
+int main(int argc, char** argv)
+{
+    if (argc < 2)
+    {
+        std::cout << "Usage: Benchmarks <name|all> [options]\nAvailable benchmarks:\n";
+        for (const BenchmarkEntry& entry : g_benchmarks)
+            std::cout << "  " << entry.name << "\n";
+        return 1;
+    }
+
+    const char* requested = argv[1];
+    bool runAll = std::strcmp(requested, "all") == 0;
+    bool found = false;
+    int result = 0;
+
+    for (const BenchmarkEntry& entry : g_benchmarks)
+    {
+        if (!runAll && std::strcmp(requested, entry.name) != 0)
+            continue;
+
+        found = true;
+        std::cout << "== " << entry.name << " ==\n";
+        result |= entry.run(argc - 2, argv + 2);
+    }
+
+    if (!found)
+    {
+        std::cerr << "Unknown benchmark: " << requested << "\n";
+        return 1;
+    }
+
+    return result;
+}
@@ -0,0 +1,44 @@
+#include "AssetId.hpp"
+#include <cstdio>
+#include <mutex>
+#include <unordered_map>
+
+#if ASSET_DEBUG_NAMES
+namespace
+{
+    struct DebugNameTable
+    {
+        std::mutex mutex;
+        std::unordered_map<uint64_t, std::string> names;
+    };
+
+    DebugNameTable& GetDebugNames()
+    {
+        static DebugNameTable table;
+        return table;
+    }
+}
+
+void AssetId::RegisterDebugName(std::string_view name) const
+{
+    DebugNameTable& table = GetDebugNames();
+    std::scoped_lock lock(table.mutex);
+    table.names.try_emplace(m_value, name);
+}
+#endif
+
+std::string AssetId::GetDebugName() const
+{
+#if ASSET_DEBUG_NAMES
+    {
+        DebugNameTable& table = GetDebugNames();
+        std::scoped_lock lock(table.mutex);
+        auto it = table.names.find(m_value);
+        if (it != table.names.end())
+            return it->second;
+    }
+#endif
+    char buffer[20];
+    std::snprintf(buffer, sizeof(buffer), "#%016llx", static_cast<unsigned long long>(m_value));
+    return buffer;
+}
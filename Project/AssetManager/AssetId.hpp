@@ -0,0 +1,75 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+
+// Debug builds remember the name behind every id, define ASSET_DEBUG_NAMES to 0 or 1 to override
+#ifndef ASSET_DEBUG_NAMES
+#ifdef _DEBUG
+#define ASSET_DEBUG_NAMES 1
+#else
+#define ASSET_DEBUG_NAMES 0
+#endif
+#endif
+
+// 64-bit FNV-1a, PackagingTool stores the same hash in the bundle
+constexpr uint64_t HashAssetName(std::string_view name)
+{
+    uint64_t hash = 0xcbf29ce484222325ull;
+    for (char c : name)
+    {
+        hash ^= static_cast<uint8_t>(c);
+        hash *= 0x100000001b3ull;
+    }
+    return hash;
+}
+
+/*
+* Asset name interned as its 64-bit hash.
+* Comparing, hashing and copying an id is one integer, so keep ids around instead of names and
+* convert once where the name comes from (config, input, the bundle). PackagingTool refuses
+* bundles where two names hash the same, so within a bundle an id is as good as its name.
+* 0 is never a valid id.
+*/
+class AssetId
+{
+public:
+    constexpr AssetId() = default;
+    constexpr explicit AssetId(uint64_t value) : m_value(value) {}
+
+    // Implicit so names can still be passed where an id is expected, each conversion hashes the name
+    AssetId(std::string_view name) : m_value(HashAssetName(name)) { RegisterDebugName(name); }
+    AssetId(const std::string& name) : AssetId(std::string_view(name)) {}
+    AssetId(const char* name) : AssetId(std::string_view(name)) {}
+
+    constexpr uint64_t GetValue() const { return m_value; }
+    constexpr bool IsValid() const { return m_value != 0; }
+
+    // The name when ASSET_DEBUG_NAMES is on and the id was made from one, otherwise the hash in hex
+    std::string GetDebugName() const;
+
+    constexpr bool operator==(AssetId other) const { return m_value == other.m_value; }
+    constexpr bool operator!=(AssetId other) const { return m_value != other.m_value; }
+    constexpr bool operator<(AssetId other) const { return m_value < other.m_value; }
+
+private:
+    uint64_t m_value = 0;
+
+#if ASSET_DEBUG_NAMES
+    void RegisterDebugName(std::string_view name) const;
+#else
+    void RegisterDebugName(std::string_view) const {}
+#endif
+};
+
+namespace std
+{
+    template<>
+    struct hash<AssetId>
+    {
+        // Already a good hash, only folded for 32-bit size_t
+        size_t operator()(AssetId id) const { return static_cast<size_t>(id.GetValue() ^ (id.GetValue() >> 32)); }
+    };
+}
@@ -1,141 +1,262 @@
 #include "AssetManager.hpp"
-#include <fstream>
+#include "LzCodec.hpp"
 #include <iostream>
 #include <algorithm>
-
-AssetManager::AssetManager(size_t memoryLimitBytes, const std::string& packagePath)
-    : m_memoryLimit(memoryLimitBytes), m_packagePath(packagePath)
+#include <vector>
+#include <chrono>
+
+AssetManager::AssetManager(size_t memoryLimitBytes, const std::string& packagePath, std::pmr::memory_resource* resource, size_t workerCount)
+    : m_memoryLimit(memoryLimitBytes), m_packagePath(packagePath),
+    m_lowWatermark(memoryLimitBytes / 100 * LowWatermarkPercent),
+    m_loaded(resource), m_lru(resource), m_pins(resource), m_schedule(resource), m_queued(resource),
+    m_inAction(resource), m_cancelled(resource), m_prefetched(resource)
 {
     PackageParser();
 
-    m_worker = std::thread(&AssetManager::WorkerLoop, this);
+    if (workerCount == 0)
+    {
+        unsigned hardware = std::thread::hardware_concurrency();
+        workerCount = hardware > 1 ? hardware - 1 : 1;
+    }
+
+    m_workers.reserve(workerCount);
+    for (size_t i = 0; i < workerCount; ++i)
+        m_workers.emplace_back(&AssetManager::WorkerLoop, this);
 }
 
 AssetManager::~AssetManager()
 {
+    //Nothing queued is worth loading anymore, the workers only finish what they are running and join
     {
         std::scoped_lock lock(m_jobQueueMutex);
-        m_stopWorker = true;
+        m_schedule.clear();
+        m_queued.clear();
+        m_prefetched.clear();
+        m_stopWorkers = true;
     }
-
     m_jobAvailable.notify_all();
 
-    if(m_worker.joinable()){
-        m_worker.join();
+    for (std::thread& worker : m_workers)
+    {
+        if (worker.joinable())
+            worker.join();
     }
 
     // Unloading
     {
         std::scoped_lock lock(m_loadedMutex);
 
-        for (auto& [guid, resource] : m_loaded)
+        for (auto& [id, asset] : m_loaded)
         {
-            resource->Unload();
+            asset.resource->Unload();
         }
 
         m_loaded.clear();
+        m_lru.clear();
         m_memoryUsed = 0;
     }
 }
 
-std::shared_ptr<IResource> AssetManager::Load(const std::string& guid)
+std::shared_ptr<IResource> AssetManager::Load(AssetId id)
 {
     {
         std::scoped_lock lock(m_loadedMutex);
-        auto it = m_loaded.find(guid);
+        auto it = m_loaded.find(id);
         if (it != m_loaded.end())
-            return it->second;
+        {
+            Touch(it->second);
+            return it->second.resource;
+        }
     }
 
-    PackageEntry entry;
-    {
-        std::shared_lock lock(m_registryMutex);
-        auto regIt = m_registry.find(guid);
-        if (regIt == m_registry.end()) 
-            return nullptr;
-        entry = regIt->second;
-    }
+    const PackageTocEntry* entry = m_toc.Find(id);
+    if (!entry)
+        return nullptr;
 
-    std::vector<uint8_t> data = ReadFromPackage(entry);
+    //Decoder temporaries go to scratch, uncompressed package bytes are read straight from the mapping
+    ScratchScope scratch;
+    ByteSpan data = ReadFromPackage(*entry, scratch);
     if (data.empty()) return nullptr;
 
-    std::shared_ptr<IResource> resource = ResourceFactory::Create(guid, entry.type);
+    std::shared_ptr<IResource> resource = ResourceFactory::Create(std::string(m_toc.GetName(*entry)), static_cast<ResourceType>(entry->type));
     if (!resource) return nullptr;
 
+    auto start = std::chrono::steady_clock::now();
     if (!resource->Load(data)) return nullptr;
+    auto loadTime = std::chrono::steady_clock::now() - start;
 
     {
         std::scoped_lock lock(m_loadedMutex);
-        EvictIfNeeded(resource->GetSize());
-        m_memoryUsed += resource->GetSize();
-        m_loaded[guid] = resource;
+        //Loaded by a worker while this thread decoded, hand out the one the others see
+        auto it = m_loaded.find(id);
+        if (it != m_loaded.end())
+        {
+            resource->Unload();
+            Touch(it->second);
+            return it->second.resource;
+        }
+        AddLoaded(id, resource, std::chrono::duration_cast<std::chrono::microseconds>(loadTime).count());
     }
     return resource;
 }
 
-void AssetManager::Unload(const std::string& guid)
+void AssetManager::Unload(AssetId id)
 {
-    std::scoped_lock lock(m_loadedMutex);
-    auto it = m_loaded.find(guid);
-    if (it == m_loaded.end())
+    std::scoped_lock lock(m_loadedMutex, m_jobQueueMutex);
+    //Another user still wants it, releasing one of them must not pull it from under the others
+    if (m_pins.find(id) != m_pins.end())
         return;
 
-    m_memoryUsed -= it->second->GetSize();
-    it->second->Unload();
-    m_loaded.erase(it);
+    if (m_inAction.find(id) != m_inAction.end())
+        CancelLocked(id);
+
+    auto it = m_loaded.find(id);
+    if (it == m_loaded.end() || it->second.resource.use_count() > 1)
+        return;
+
+    RemoveLoaded(it);
 }
 
-void AssetManager::LoadAsync(const std::string& guid)
+void AssetManager::LoadAsync(AssetId id, LoadPriority priority, uint64_t deadlineFrame)
 {
     {
         std::scoped_lock lock(m_loadedMutex);
-        auto it = m_loaded.find(guid);
+        auto it = m_loaded.find(id);
         if (it != m_loaded.end())
+        {
+            Touch(it->second);
             return;
+        }
     }
 
     {
         std::scoped_lock lock(m_jobQueueMutex);
-        auto actionIt = m_inAction.find(guid);
+        auto actionIt = m_inAction.find(id);
         if (actionIt != m_inAction.end())
+        {
+            //Wanted again before the cancelled load finished, keep its result after all
+            m_cancelled.erase(id);
+
+            auto queuedIt = m_queued.find(id);
+            if (queuedIt != m_queued.end())
+            {
+                ScheduledLoad& load = queuedIt->second;
+                Reschedule(load, std::min(load.priority, priority), std::min(load.deadline, deadlineFrame));
+            }
             return;
+        }
 
-        auto regIt = m_registry.find(guid);
-        if (regIt == m_registry.end()) {
-            std::cerr << "ResourceManager::LoadAsync Unknown GUID: " << guid << "\n";
+        if (!m_toc.Find(id)) {
+            std::cerr << "ResourceManager::LoadAsync Unknown GUID: " << id.GetDebugName() << "\n";
             return;
         }
 
-        m_inAction.insert(guid);
+        m_inAction.insert(id);
+
+        ScheduledLoad load{ priority, deadlineFrame, m_nextSequence++, id };
+        m_schedule.insert(load);
+        m_queued.emplace(id, std::move(load));
+    }
+
+    m_jobAvailable.notify_one();
+    PrefetchQueued();
+}
+
+bool AssetManager::Reprioritize(AssetId id, LoadPriority priority, uint64_t deadlineFrame)
+{
+    {
+        std::scoped_lock lock(m_jobQueueMutex);
+        auto it = m_queued.find(id);
+        if (it == m_queued.end())
+            return false;
+
+        Reschedule(it->second, priority, deadlineFrame);
+    }
+    PrefetchQueued();
+    return true;
+}
+
+void AssetManager::BeginFrame(uint64_t frame)
+{
+    {
+        std::scoped_lock lock(m_jobQueueMutex);
+        m_frame = frame;
 
-        LoadJob job;
-        job.guid = guid;
-        m_jobQueue.push(job);
+        //Critical loads already come first, only the others can be overdue
+        std::vector<AssetId> overdue;
+        for (const ScheduledLoad& load : m_schedule)
+        {
+            if (load.priority != LoadPriority::Critical && load.deadline <= frame)
+                overdue.push_back(load.id);
+        }
 
-        m_jobAvailable.notify_one();
+        for (AssetId id : overdue)
+        {
+            ScheduledLoad& load = m_queued.find(id)->second;
+            Reschedule(load, LoadPriority::Critical, load.deadline);
+        }
     }
+    PrefetchQueued();
+}
 
+uint64_t AssetManager::GetFrame() const
+{
+    std::scoped_lock lock(m_jobQueueMutex);
+    return m_frame;
 }
 
-bool AssetManager::IsLoaded(const std::string& guid) const
+bool AssetManager::IsLoaded(AssetId id) const
 {
     std::scoped_lock lock(m_loadedMutex);
-    return m_loaded.find(guid) != m_loaded.end();
+    return m_loaded.find(id) != m_loaded.end();
 }
 
-std::shared_ptr<IResource> AssetManager::TryGet(const std::string& guid)
+std::shared_ptr<IResource> AssetManager::TryGet(AssetId id)
 {
     std::scoped_lock lock(m_loadedMutex);
-    auto it = m_loaded.find(guid);
-    return (it != m_loaded.end()) ? it->second : nullptr;
+    auto it = m_loaded.find(id);
+    if (it == m_loaded.end())
+        return nullptr;
+
+    Touch(it->second);
+    return it->second.resource;
+}
+
+void AssetManager::Pin(AssetId id)
+{
+    std::scoped_lock lock(m_loadedMutex);
+    ++m_pins[id];
+}
+
+void AssetManager::Unpin(AssetId id)
+{
+    std::scoped_lock lock(m_loadedMutex);
+    auto it = m_pins.find(id);
+    if (it == m_pins.end())
+    {
+        std::cerr << "AssetManager::Unpin " << id.GetDebugName() << " is not pinned\n";
+        return;
+    }
+
+    if (--it->second == 0)
+        m_pins.erase(it);
+}
+
+void AssetManager::SetLowWatermark(size_t bytes)
+{
+    std::scoped_lock lock(m_loadedMutex);
+    m_lowWatermark = std::min(bytes, m_memoryLimit);
 }
 
 void AssetManager::DumpLoadedResources() const
 {
-    std::cout << "Loaded resources:\n";
-    for (auto& [guid, res] : m_loaded) 
+    std::scoped_lock lock(m_loadedMutex);
+    std::cout << "Loaded resources, most recently used first:\n";
+    for (AssetId id : m_lru)
     {
-        std::cout << " - " << guid << " | Size: " << res->GetSize() << " bytes\n";
+        const LoadedAsset& asset = m_loaded.find(id)->second;
+        std::cout << " - " << asset.resource->GetGUID() << " | Size: " << asset.size << " bytes | Load: "
+            << asset.loadMicroseconds << " us" << (m_pins.count(id) ? " | Pinned" : "") << "\n";
     }
 }
 
@@ -145,205 +266,279 @@ void AssetManager::GetDebugInfo(AssetManagerDebugInfo& outinfo) const
         std::scoped_lock lock(m_loadedMutex);
         outinfo.memoryLimit = m_memoryLimit;
         outinfo.memoryUsed = m_memoryUsed;
+        outinfo.memoryLowWatermark = m_lowWatermark;
         outinfo.loadedResourceCount = m_loaded.size();
         outinfo.totalEvictions = m_totalEvictions;
+        outinfo.pinnedResourceCount = m_pins.size();
     }
 
     {
         std::scoped_lock lock(m_jobQueueMutex);
-        outinfo.asyncQueuedJobs = m_jobQueue.size();
-        outinfo.asyncActiveJobs = m_inAction.size();
+        outinfo.asyncQueuedJobs = m_schedule.size();
+        outinfo.asyncActiveJobs = m_inAction.size() - m_schedule.size();
+        outinfo.cancelledJobs = m_cancelledJobs;
+        outinfo.ioQueueDepth = m_prefetched.size();
+        outinfo.totalPrefetches = m_totalPrefetches;
     }
+    outinfo.workerCount = m_workers.size();
 }
 
 
-std::vector<uint8_t> AssetManager::ReadFromPackage(const PackageEntry& entry)
+ByteSpan AssetManager::ReadFromPackage(const PackageTocEntry& entry, ScratchScope& scratch) const
 {
-    std::ifstream file(m_packagePath, std::ios::binary);
-    if (!file) return {};
+    ByteSpan stored = m_package.GetSpan(entry.offset, entry.size);
+    if (stored.empty() || (entry.flags & ~PackageKnownEntryFlags) != 0)
+        return {};
 
-    file.seekg(entry.offset, std::ios::beg);
+    if ((entry.flags & PackageEntryLz) == 0)
+        return stored;
 
-    std::vector<uint8_t> buffer(entry.size);
-    file.read(reinterpret_cast<char*>(buffer.data()), entry.size);
-
-    return buffer;
+    //Decompressed on the thread that loads it, so workers decode in parallel
+    uint8_t* buffer = static_cast<uint8_t*>(scratch.Allocate(entry.uncompressedSize, 16));
+    if (!buffer || !LzDecompress(stored, buffer, entry.uncompressedSize))
+    {
+        std::cerr << "AssetManager: Corrupt compressed payload: " << m_toc.GetName(entry) << "\n";
+        return {};
+    }
+    return ByteSpan{ buffer, entry.uncompressedSize };
 }
 
 void AssetManager::EvictIfNeeded(size_t neededMemory)
 {
-    while (m_memoryUsed + neededMemory > m_memoryLimit && !m_loaded.empty()) 
+    if (m_memoryUsed + neededMemory <= m_memoryLimit)
+        return;
+
+    //Evict down to the low watermark rather than just enough, otherwise every following load evicts again
+    size_t target = m_lowWatermark > neededMemory ? m_lowWatermark - neededMemory : 0;
+    size_t evicted = 0;
+    while (m_memoryUsed > target)
     {
-        auto it = m_loaded.begin();
-        m_memoryUsed -= it->second->GetSize();
-        it->second->Unload();
-        m_loaded.erase(it);
+        auto victim = FindEvictionVictim();
+        if (victim == m_loaded.end())
+            break;
+
+        RemoveLoaded(victim);
         ++m_totalEvictions;
-        std::cerr << "AssetManager: No space! Evicting resources.\n";
+        ++evicted;
     }
 
+    if (evicted != 0)
+        std::cerr << "AssetManager: No space! Evicted " << evicted << " resources.\n";
+
     if (m_memoryUsed + neededMemory > m_memoryLimit) 
     {
-        std::cerr << "AssetManager: Memory limit exceeded! Cannot load resource.\n";
+        std::cerr << "AssetManager: Memory limit exceeded! Everything left is pinned or in use.\n";
     }
 }
 
-bool AssetManager::PackageParser()
+AssetManager::AssetMap<AssetManager::LoadedAsset>::iterator AssetManager::FindEvictionVictim()
 {
+    auto victim = m_loaded.end();
+    double victimCost = 0.0;
+    size_t candidates = 0;
 
-    std::ifstream file(m_packagePath, std::ios::binary);
-    if (!file) {
-        std::cerr << "AssetManager: Failed to open package: " << m_packagePath << "\n";
-        return false;
-    }
+    //From the least recently used end. Of the first few that may go, evict the one that is cheapest to load again per byte freed
+    for (auto lruIt = m_lru.rbegin(); lruIt != m_lru.rend() && candidates < EvictionCandidates; ++lruIt)
+    {
+        if (m_pins.find(*lruIt) != m_pins.end())
+            continue;
 
-    uint32_t headerSize = 0;
-    file.read(reinterpret_cast<char*>(&headerSize), sizeof(headerSize));
-    if (!file) {
-        std::cerr << "AssetManager: Failed to read header size\n";
-        return false;
-    }
+        auto it = m_loaded.find(*lruIt);
+        //The map holds one reference, anyone else still holding one would keep using an unloaded resource
+        if (it->second.resource.use_count() > 1)
+            continue;
 
-    std::string headerJson(headerSize, '\0');
-    file.read(&headerJson[0], headerSize);
-    if (!file) {
-        std::cerr << "AssetManager: Failed to read header data\n";
-        return false;
+        ++candidates;
+        double cost = double(it->second.loadMicroseconds + 1) / double(it->second.size + 1);
+        if (victim == m_loaded.end() || cost < victimCost)
+        {
+            victim = it;
+            victimCost = cost;
+        }
     }
+    return victim;
+}
 
-    size_t dataStartOffset = sizeof(uint32_t) + headerSize;
+void AssetManager::AddLoaded(AssetId id, std::shared_ptr<IResource> resource, uint64_t loadMicroseconds)
+{
+    size_t size = resource->GetSize();
+    EvictIfNeeded(size);
 
-    size_t pos = headerJson.find("\"assets\":[");
-    if (pos == std::string::npos) {
-        std::cerr << "AssetManager: Invalid header format\n";
+    m_lru.push_front(id);
+    m_loaded.emplace(id, LoadedAsset{ std::move(resource), size, loadMicroseconds, m_lru.begin() });
+    m_memoryUsed += size;
+}
+
+void AssetManager::RemoveLoaded(AssetMap<LoadedAsset>::iterator it)
+{
+    m_memoryUsed -= it->second.size;
+    it->second.resource->Unload();
+    m_lru.erase(it->second.lruPosition);
+    m_loaded.erase(it);
+}
+
+void AssetManager::Touch(LoadedAsset& asset)
+{
+    m_lru.splice(m_lru.begin(), m_lru, asset.lruPosition);
+}
+
+bool AssetManager::PackageParser()
+{
+    if (!m_package.Open(m_packagePath)) {
+        std::cerr << "AssetManager: Failed to open package: " << m_packagePath << "\n";
         return false;
     }
 
-    pos = headerJson.find('[', pos);
-    size_t endPos = headerJson.rfind(']');
-
-    size_t current = pos + 1;
-    while (current < endPos) {
+    //Only the header is checked, lookups read the table of contents straight from the mapping
+    if (!m_toc.Attach(m_package.GetSpan(0, m_package.GetSize()))) {
+        std::cerr << "AssetManager: Invalid package: " << m_packagePath << "\n";
+        return false;
+    }
 
-        size_t objStart = headerJson.find('{', current);
-        if (objStart == std::string::npos || objStart >= endPos) break;
+    std::cout << "AssetManager: Loaded " << m_toc.GetEntryCount() << " assets from package\n";
+    return true;
+}
 
-        size_t objEnd = headerJson.find('}', objStart);
-        if (objEnd == std::string::npos) break;
+void AssetManager::WorkerLoop()
+{
+    while (true)
+    {
+        AssetId id;
+        {
+            std::unique_lock<std::mutex> lock(m_jobQueueMutex);
 
-        std::string obj = headerJson.substr(objStart, objEnd - objStart + 1);
+            //A cancelled load leaves the schedule empty again, the worker goes back to waiting
+            while (m_schedule.empty() && !m_stopWorkers)
+                m_jobAvailable.wait(lock);
 
-        PackageEntry entry;
-        std::string guid;
+            if (m_stopWorkers)
+                return;
 
-        size_t guidPos = obj.find("\"guid\":");
-        if (guidPos != std::string::npos) {
-            size_t guidStart = obj.find('"', guidPos + 7) + 1;
-            size_t guidEnd = obj.find('"', guidStart);
-            guid = obj.substr(guidStart, guidEnd - guidStart);
+            auto next = m_schedule.begin();
+            id = next->id;
+            m_queued.erase(id);
+            m_prefetched.erase(id);
+            m_schedule.erase(next);
         }
 
-        size_t typePos = obj.find("\"type\":");
-        if (typePos != std::string::npos) {
-            size_t typeStart = typePos + 7;
-            while (typeStart < obj.size() && (obj[typeStart] == ' ' || obj[typeStart] == ':')) typeStart++;
-            size_t typeEnd = obj.find_first_of(",}", typeStart);
-            int typeInt = std::stoi(obj.substr(typeStart, typeEnd - typeStart));
-            entry.type = static_cast<ResourceType>(typeInt);
-        }
+        //The next load moves up into the prefetch window while this one decodes
+        PrefetchQueued();
+        ProcessJob(id);
+    }
+}
 
-        size_t offsetPos = obj.find("\"offset\":");
-        if (offsetPos != std::string::npos) {
-            size_t offsetStart = offsetPos + 9;
-            while (offsetStart < obj.size() && (obj[offsetStart] == ' ' || obj[offsetStart] == ':')) offsetStart++;
-            size_t offsetEnd = obj.find_first_of(",}", offsetStart);
-            entry.offset = std::stoull(obj.substr(offsetStart, offsetEnd - offsetStart));
-            entry.offset += dataStartOffset;
-        }
+void AssetManager::ProcessJob(AssetId id)
+{
 
-        size_t sizePos = obj.find("\"size\":");
-        if (sizePos != std::string::npos) {
-            size_t sizeStart = sizePos + 7;
-            while (sizeStart < obj.size() && (obj[sizeStart] == ' ' || obj[sizeStart] == ':')) sizeStart++;
-            size_t sizeEnd = obj.find_first_of(",}", sizeStart);    
-            entry.size = std::stoull(obj.substr(sizeStart, sizeEnd - sizeStart));
-        }
+    //The table of contents is read-only, workers look up in it unlocked
+    const PackageTocEntry* entry = m_toc.Find(id);
+    if(!entry){
+        std::cerr << "WorkerLoop Error: GUID not found in package: " << id.GetDebugName() << std::endl;
+        EraseJob(id);
+        return;
+    }
 
-        if (!guid.empty()) {
-            m_registry[guid] = entry;
-        }
+    //Decompressed payload and decoder temporaries in scratch are rewound when the job ends
+    ScratchScope scratch;
+    ByteSpan data = ReadFromPackage(*entry, scratch);
+    if(data.empty()){
+        std::cerr << "WorkerLoop Error: Failed to read data for GUID: " << id.GetDebugName() << std::endl;
+        EraseJob(id);
+        return;
+    }
 
-        current = objEnd + 1;
+    std::shared_ptr<IResource> resource = ResourceFactory::Create(std::string(m_toc.GetName(*entry)), static_cast<ResourceType>(entry->type));
+    if(!resource){
+        std::cerr << "WorkerLoop Error: Unsupported resource type for GUID: " << id.GetDebugName() << std::endl;
+        EraseJob(id);
+        return;
     }
 
-    std::cout << "AssetManager: Loaded " << m_registry.size() << " assets from package\n";
+    auto start = std::chrono::steady_clock::now();
+    if(!resource->Load(data)){
+        std::cerr << "WorkerLoop Error: Resource->Load() failed for GUID: " << id.GetDebugName() << "\n";
+        EraseJob(id);
+        return;
+    }
+    auto loadTime = std::chrono::steady_clock::now() - start;
     
-    return true;
+#ifdef _DEBUG
+    std::this_thread::sleep_for(std::chrono::milliseconds(10)); //Just for visual see that something happens in debug
+#endif
+    {
+        //Both locks, so an Unload either cancels the load or finds the resource, never neither
+        std::scoped_lock lock(m_loadedMutex, m_jobQueueMutex);
+        bool cancelled = m_cancelled.erase(id) != 0;
+        if (cancelled || m_loaded.find(id) != m_loaded.end())
+        {
+            resource->Unload();
+        }
+        else
+        {
+            AddLoaded(id, resource, std::chrono::duration_cast<std::chrono::microseconds>(loadTime).count());
+        }
+        m_inAction.erase(id);
+    }
 }
 
-void AssetManager::WorkerLoop()
+void AssetManager::Reschedule(ScheduledLoad& load, LoadPriority priority, uint64_t deadlineFrame)
 {
-    while (true){
-        LoadJob job;
-        {
-            std::unique_lock<std::mutex> lock(m_jobQueueMutex);
-
-            while(m_jobQueue.empty() && !m_stopWorker){
-                m_jobAvailable.wait(lock);
-            }
+    if (load.priority == priority && load.deadline == deadlineFrame)
+        return;
 
-            if(m_stopWorker && m_jobQueue.empty()){
-                return;
-            }
+    m_schedule.erase(load);
+    load.priority = priority;
+    load.deadline = deadlineFrame;
+    m_schedule.insert(load);
+}
 
-            job = m_jobQueue.front();
-            m_jobQueue.pop();
-        }
-        
-        auto regIt = m_registry.find(job.guid);
-        if(regIt == m_registry.end()){
-            std::cerr << "WorkerLoop Error: GUID not found in registry: " << job.guid << std::endl;
-            EraseJob(job.guid);
-            continue;
-        }
+void AssetManager::CancelLocked(AssetId id)
+{
+    ++m_cancelledJobs;
 
-        const PackageEntry& entry = regIt->second;
-        std::vector<uint8_t> data = ReadFromPackage(entry);
-        if(data.empty()){
-            std::cerr << "WorkerLoop Error: Failed to read data for GUID: " << job.guid << std::endl;
-            EraseJob(job.guid);
-            continue;
-        }
+    auto queuedIt = m_queued.find(id);
+    if (queuedIt == m_queued.end())
+    {
+        //Already running, it cannot be stopped halfway through a decode
+        m_cancelled.insert(id);
+        return;
+    }
 
-        std::shared_ptr<IResource> resource = ResourceFactory::Create(job.guid, entry.type);
-        if(!resource){
-            std::cerr << "WorkerLoop Error: Unsupported resource type for GUID: " << job.guid << std::endl;
-            EraseJob(job.guid);
-            continue;
-        }
+    m_schedule.erase(queuedIt->second);
+    m_queued.erase(queuedIt);
+    m_inAction.erase(id);
+    m_prefetched.erase(id);
+}
 
-        if(!resource->Load(data)){
-            std::cerr << "WorkerLoop Error: Resource->Load() failed for GUID: " << job.guid << "\n";
-            EraseJob(job.guid);
-            continue;
-        }
-        
-        std::this_thread::sleep_for(std::chrono::milliseconds(10)); //Just for visual see that something happens in debug
+void AssetManager::PrefetchQueued()
+{
+    FileRange ranges[PrefetchDepth];
+    size_t count = 0;
+    {
+        std::scoped_lock lock(m_jobQueueMutex);
+        size_t depth = 0;
+        for (auto it = m_schedule.begin(); it != m_schedule.end() && depth < PrefetchDepth; ++it, ++depth)
         {
-            std::scoped_lock lock(m_loadedMutex);
-            EvictIfNeeded(resource->GetSize());
-            m_memoryUsed += resource->GetSize();
-            m_loaded[job.guid] = resource;
-        }
+            if (!m_prefetched.insert(it->id).second)
+                continue;
 
-        EraseJob(job.guid);
+            const PackageTocEntry* entry = m_toc.Find(it->id);
+            if (entry)
+                ranges[count++] = { entry->offset, entry->size };
+        }
+        m_totalPrefetches += count;
     }
+
+    //One batch for everything that entered the window
+    if (count != 0)
+        m_package.Prefetch(ranges, count);
 }
 
-void AssetManager::EraseJob(const std::string& guid)
+void AssetManager::EraseJob(AssetId id)
 {
     {
         std::scoped_lock lock(m_jobQueueMutex);
-        m_inAction.erase(guid);
+        m_inAction.erase(id);
+        m_cancelled.erase(id);
     }
 }
\ No newline at end of file
@@ -1,42 +1,80 @@
 #pragma once
 #include <unordered_map>
 #include <unordered_set>
+#include <set>
+#include <list>
+#include <memory_resource>
 #include <string>
 #include <memory>
 #include <mutex>
-#include <shared_mutex>
 #include <thread>
-#include <queue>
 #include <condition_variable>
+#include <vector>
 #include "IResource.hpp"
 #include "ResourceFactory.hpp"
-
-struct PackageEntry {
-    ResourceType type;
-    uint32_t offset;
-    uint32_t size;
-};
+#include "MappedFile.hpp"
+#include "PackageFormat.hpp"
+#include "AssetId.hpp"
+#include "../MemoryManager/MemoryResources.hpp"
+#include "../MemoryManager/ScratchArena.hpp"
 
 struct AssetManagerDebugInfo
 {
     size_t memoryUsed = 0;
     size_t memoryLimit = 0;
+    size_t memoryLowWatermark = 0;
     size_t loadedResourceCount = 0;
     size_t asyncQueuedJobs = 0;
     size_t asyncActiveJobs = 0;
     size_t totalEvictions = 0;
+    size_t pinnedResourceCount = 0;
+    size_t workerCount = 0;
+    size_t cancelledJobs = 0;
+    size_t ioQueueDepth = 0;        // queued loads whose payload was prefetched, waiting for a worker
+    size_t totalPrefetches = 0;
+};
+
+// Lower runs first. Loads with the same priority run by deadline, then in request order
+enum class LoadPriority : uint8_t
+{
+    Critical,   // needed this frame, overdue deadlines are promoted here
+    Visible,    // on screen, drawn with a placeholder until loaded
+    Normal,
+    Background  // prefetching and stress loads
 };
 
 class AssetManager {
 public:
-    AssetManager(size_t memoryLimitBytes, const std::string& packagePath);
+    // Bookkeeping containers allocate from resource, which must outlive the manager and be thread-safe.
+    // workerCount 0 starts one loader thread per hardware thread, minus the main thread
+    AssetManager(size_t memoryLimitBytes, const std::string& packagePath,
+        std::pmr::memory_resource* resource = GetSmallObjectResource(), size_t workerCount = 0);
     ~AssetManager();
-    std::shared_ptr<IResource> Load(const std::string& guid);
-    void Unload(const std::string& guid);
+    std::shared_ptr<IResource> Load(AssetId id);
+    // Does nothing while the asset is pinned or a shared_ptr to it is held outside the manager,
+    // it stays cached and eviction reclaims it once the last pin and reference are gone
+    void Unload(AssetId id);
+
+    static constexpr uint64_t NoDeadline = UINT64_MAX;
+
+    // Requesting a queued id again only moves it up, to the higher priority or earlier deadline of the two.
+    // deadlineFrame is compared against the frame passed to BeginFrame
+    void LoadAsync(AssetId id, LoadPriority priority = LoadPriority::Normal, uint64_t deadlineFrame = NoDeadline);
+    // Replaces priority and deadline of a queued load, false if the id is not queued (loading, loaded or unknown)
+    bool Reprioritize(AssetId id, LoadPriority priority, uint64_t deadlineFrame = NoDeadline);
+    // Promotes queued loads whose deadline has come to Critical
+    void BeginFrame(uint64_t frame);
+    uint64_t GetFrame() const;
+
+    bool IsLoaded(AssetId id) const;
+    std::shared_ptr<IResource> TryGet(AssetId id);
+
+    // Pinned assets are never evicted. Pins nest and can be taken before the asset is loaded
+    void Pin(AssetId id);
+    void Unpin(AssetId id);
 
-    void LoadAsync(const std::string& guid);
-    bool IsLoaded(const std::string& guid) const;
-    std::shared_ptr<IResource> TryGet(const std::string& guid);
+    // Once over the limit, eviction frees memory down to this so the next loads do not evict again
+    void SetLowWatermark(size_t bytes);
 
     void DumpLoadedResources() const;
 
@@ -47,30 +85,89 @@ private:
     size_t m_memoryLimit;
     size_t m_memoryUsed = 0;
 
-    mutable std::shared_mutex m_registryMutex;
     mutable std::mutex m_loadedMutex;
     mutable std::mutex m_memoryMutex;
     mutable std::mutex m_jobQueueMutex;
 
-    std::unordered_map<std::string, std::shared_ptr<IResource>> m_loaded;
-    std::unordered_map<std::string, PackageEntry> m_registry;
+    template<typename Value>
+    using AssetMap = std::pmr::unordered_map<AssetId, Value>;
+    using AssetSet = std::pmr::unordered_set<AssetId>;
 
-    struct LoadJob{
-        std::string guid;
+    // Every loaded asset is in m_lru, most recently used first
+    struct LoadedAsset{
+        std::shared_ptr<IResource> resource;
+        size_t size;                    // counted in m_memoryUsed when it was added
+        uint64_t loadMicroseconds;      // what loading it again would cost
+        std::pmr::list<AssetId>::iterator lruPosition;
     };
 
-    std::queue<LoadJob> m_jobQueue;
-    std::condition_variable m_jobAvailable;
-    std::unordered_set<std::string> m_inAction;
+    // Default low watermark, in percent of the limit
+    static constexpr size_t LowWatermarkPercent = 85;
+    // How many evictable assets from the cold end are compared on reload cost
+    static constexpr size_t EvictionCandidates = 8;
+
+    size_t m_lowWatermark;
+    AssetMap<LoadedAsset> m_loaded;
+    std::pmr::list<AssetId> m_lru;
+    AssetMap<uint32_t> m_pins;
+    // Mapped once for the manager's lifetime, workers look up and decode straight out of it
+    MappedFile m_package;
+    PackageToc m_toc;
+
+    struct ScheduledLoad{
+        LoadPriority priority;
+        uint64_t deadline;
+        uint64_t sequence;
+        AssetId id;
+
+        bool operator<(const ScheduledLoad& other) const
+        {
+            if (priority != other.priority) return priority < other.priority;
+            if (deadline != other.deadline) return deadline < other.deadline;
+            return sequence < other.sequence;
+        }
+    };
 
-    std::thread m_worker;
-    bool m_stopWorker = false;
+    // Queued loads, ordered. m_queued finds an id's entry for reprioritizing and cancelling.
+    // Idle workers wait on m_jobAvailable and take the first load, so reordering and cancelling only touch the set
+    std::pmr::set<ScheduledLoad> m_schedule;
+    AssetMap<ScheduledLoad> m_queued;
+    uint64_t m_nextSequence = 0;
+    uint64_t m_frame = 0;
+
+    // Queued or loading, an id is only ever handed to one worker
+    AssetSet m_inAction;
+    // Loading but unloaded in the meantime, the result is thrown away
+    AssetSet m_cancelled;
+    size_t m_cancelledJobs = 0;
+
+    // The first PrefetchDepth loads of the schedule have their payload read into the file cache in the
+    // background, so a worker finds it resident when it gets there instead of faulting it in
+    static constexpr size_t PrefetchDepth = 16;
+    AssetSet m_prefetched;
+    size_t m_totalPrefetches = 0;
+
+    std::condition_variable m_jobAvailable;
+    std::vector<std::thread> m_workers;
+    bool m_stopWorkers = false;
     size_t m_totalEvictions = 0;
 
     void WorkerLoop();
-    std::vector<uint8_t> ReadFromPackage(const PackageEntry& entry);
+    void ProcessJob(AssetId id);
+    // Takes m_jobQueueMutex, the hints themselves are issued after releasing it
+    void PrefetchQueued();
+    // Both expect m_jobQueueMutex to be held
+    void Reschedule(ScheduledLoad& load, LoadPriority priority, uint64_t deadlineFrame);
+    void CancelLocked(AssetId id);
+    // Slice of the mapped package, or the payload decompressed into scratch. Empty on failure
+    ByteSpan ReadFromPackage(const PackageTocEntry& entry, ScratchScope& scratch) const;
+    // All expect m_loadedMutex to be held
     void EvictIfNeeded(size_t neededMemory);
+    AssetMap<LoadedAsset>::iterator FindEvictionVictim();
+    void AddLoaded(AssetId id, std::shared_ptr<IResource> resource, uint64_t loadMicroseconds);
+    void RemoveLoaded(AssetMap<LoadedAsset>::iterator it);
+    void Touch(LoadedAsset& asset);
     bool PackageParser();
-    void EraseJob(const std::string& guid);
+    void EraseJob(AssetId id);
 
 };
@@ -1,8 +1,20 @@
 #pragma once
+#include <cstddef>
+#include <cstdint>
 #include <string>
-#include <vector>
 #include "ResourceTypeEnum.h"
 
+// Non-owning view of the bytes a resource is loaded from, only valid during the Load call
+struct ByteSpan
+{
+    const uint8_t* data = nullptr;
+    size_t size = 0;
+
+    bool empty() const { return size == 0; }
+    const uint8_t* begin() const { return data; }
+    const uint8_t* end() const { return data + size; }
+};
+
 class IResource {
 public:
     IResource(std::string guid, ResourceType type)
@@ -15,8 +27,8 @@ public:
     size_t GetSize() const { return m_size; }
     bool IsLoaded() const { return m_loaded; }
 
-    // Load from memory buffer
-    virtual bool Load(const std::vector<uint8_t>& data) = 0;
+    // Load from memory buffer, the data usually lives in scratch memory so keep a copy of anything needed later
+    virtual bool Load(ByteSpan data) = 0;
     
     // Unload frees internal memory
     virtual bool Unload() = 0;
@@ -0,0 +1,181 @@
+#include "LzCodec.hpp"
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+namespace
+{
+    constexpr size_t MinMatch = 4;
+    constexpr size_t LastLiterals = 5;          // a match never reaches closer to the end than this
+    constexpr size_t MatchSearchMargin = 12;    // and never starts closer than this
+    constexpr size_t MaxOffset = 65535;
+    constexpr int HashBits = 14;
+    constexpr size_t FastCopy = 16;             // short copies are done as one fixed size copy when there is room
+
+    uint32_t Read32(const uint8_t* p)
+    {
+        uint32_t value;
+        std::memcpy(&value, p, sizeof(value));
+        return value;
+    }
+
+    uint32_t HashSequence(uint32_t sequence)
+    {
+        return (sequence * 2654435761u) >> (32 - HashBits);
+    }
+
+    // The part of a count past the 15 that fits in the token
+    uint8_t* WriteCount(uint8_t* out, size_t count)
+    {
+        for (; count >= 255; count -= 255)
+            *out++ = 255;
+        *out++ = static_cast<uint8_t>(count);
+        return out;
+    }
+
+    bool ReadCount(const uint8_t*& in, const uint8_t* end, size_t& count)
+    {
+        uint8_t byte;
+        do
+        {
+            if (in == end)
+                return false;
+            byte = *in++;
+            count += byte;
+        } while (byte == 255);
+        return true;
+    }
+
+    uint8_t* WriteLiterals(uint8_t* out, uint8_t& token, const uint8_t* literals, size_t count)
+    {
+        token = static_cast<uint8_t>(std::min<size_t>(count, 15) << 4);
+        if (count >= 15)
+            out = WriteCount(out, count - 15);
+        if (count != 0)
+            std::memcpy(out, literals, count);
+        return out + count;
+    }
+}
+
+size_t LzCompress(ByteSpan source, uint8_t* destination, size_t capacity)
+{
+    if (capacity < LzCompressBound(source.size))
+        return 0;
+
+    const uint8_t* const begin = source.data;
+    const uint8_t* const end = source.data + source.size;
+    const uint8_t* anchor = begin;
+    uint8_t* out = destination;
+
+    if (source.size > MatchSearchMargin)
+    {
+        //Positions from begin, a stale or empty slot is caught by comparing the bytes
+        std::vector<uint32_t> table(size_t(1) << HashBits, 0);
+        const uint8_t* const matchLimit = end - LastLiterals;
+        const uint8_t* const searchEnd = end - MatchSearchMargin;
+        const uint8_t* in = begin;
+        size_t misses = 0;
+
+        while (in < searchEnd)
+        {
+            uint32_t sequence = Read32(in);
+            uint32_t& slot = table[HashSequence(sequence)];
+            const uint8_t* candidate = begin + slot;
+            slot = static_cast<uint32_t>(in - begin);
+
+            if (candidate >= in || size_t(in - candidate) > MaxOffset || Read32(candidate) != sequence)
+            {
+                //Step faster through data that does not compress, PNGs are mostly that
+                in += 1 + (misses++ >> 6);
+                continue;
+            }
+            misses = 0;
+
+            size_t matchLength = MinMatch;
+            while (in + matchLength < matchLimit && in[matchLength] == candidate[matchLength])
+                ++matchLength;
+
+            uint8_t* token = out++;
+            out = WriteLiterals(out, *token, anchor, size_t(in - anchor));
+
+            size_t offset = size_t(in - candidate);
+            *out++ = static_cast<uint8_t>(offset);
+            *out++ = static_cast<uint8_t>(offset >> 8);
+
+            size_t extra = matchLength - MinMatch;
+            *token |= static_cast<uint8_t>(std::min<size_t>(extra, 15));
+            if (extra >= 15)
+                out = WriteCount(out, extra - 15);
+
+            in += matchLength;
+            anchor = in;
+        }
+    }
+
+    uint8_t* token = out++;
+    out = WriteLiterals(out, *token, anchor, size_t(end - anchor));
+    return size_t(out - destination);
+}
+
+bool LzDecompress(ByteSpan source, uint8_t* destination, size_t destinationSize)
+{
+    const uint8_t* in = source.data;
+    const uint8_t* const inEnd = source.data + source.size;
+    uint8_t* out = destination;
+    uint8_t* const outEnd = destination + destinationSize;
+
+    while (in < inEnd)
+    {
+        uint8_t token = *in++;
+
+        size_t literals = token >> 4;
+        if (literals == 15 && !ReadCount(in, inEnd, literals))
+            return false;
+        if (literals > size_t(inEnd - in) || literals > size_t(outEnd - out))
+            return false;
+        //Copying past the literals is fine, the next sequence overwrites it and it stays inside both buffers
+        if (literals <= FastCopy && size_t(inEnd - in) >= FastCopy && size_t(outEnd - out) >= FastCopy)
+            std::memcpy(out, in, FastCopy);
+        else
+            std::memcpy(out, in, literals);
+        in += literals;
+        out += literals;
+
+        //Only the last sequence has no match
+        if (in == inEnd)
+            break;
+
+        if (inEnd - in < 2)
+            return false;
+        size_t offset = size_t(in[0]) | (size_t(in[1]) << 8);
+        in += 2;
+        if (offset == 0 || offset > size_t(out - destination))
+            return false;
+
+        size_t matchLength = token & 15;
+        if (matchLength == 15 && !ReadCount(in, inEnd, matchLength))
+            return false;
+        matchLength += MinMatch;
+        if (matchLength > size_t(outEnd - out))
+            return false;
+
+        //A match closer than its length repeats itself. Everything from match to out is whole periods,
+        //so copying that doubles the run each time and memcpy never overlaps
+        const uint8_t* match = out - offset;
+        if (offset >= FastCopy && matchLength <= FastCopy && size_t(outEnd - out) >= FastCopy)
+        {
+            std::memcpy(out, match, FastCopy);
+            out += matchLength;
+            continue;
+        }
+        while (matchLength > 0)
+        {
+            size_t chunk = std::min(matchLength, size_t(out - match));
+            std::memcpy(out, match, chunk);
+            out += chunk;
+            matchLength -= chunk;
+        }
+    }
+
+    return out == outEnd;
+}
@@ -0,0 +1,25 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include "IResource.hpp"
+
+/*
+* Small LZ77 block codec for bundle payloads, same sequence layout as LZ4 blocks.
+* Each sequence is a token (literal count << 4 | match length - 4), the literals, then a
+* 16-bit little endian match offset. Counts of 15 continue in bytes of up to 255. The block
+* always ends in a sequence with only literals.
+* Compression is a greedy single probe hash match, meant for PackagingTool. Decompression
+* is only memcpy and length checks, it runs on the loader threads with no state of its own.
+*/
+
+// Worst case output of LzCompress, for data that does not compress at all
+constexpr size_t LzCompressBound(size_t size)
+{
+    return size + size / 255 + 16;
+}
+
+// Returns the compressed size, 0 if capacity is less than LzCompressBound(source.size)
+size_t LzCompress(ByteSpan source, uint8_t* destination, size_t capacity);
+
+// Decodes exactly destinationSize bytes. False on corrupt input, nothing is read or written out of bounds
+bool LzDecompress(ByteSpan source, uint8_t* destination, size_t destinationSize);
@@ -0,0 +1,144 @@
+#include "MappedFile.hpp"
+#include <iostream>
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::~MappedFile()
+{
+    Close();
+}
+
+bool MappedFile::Open(const std::string& path)
+{
+    Close();
+
+#ifdef _WIN32
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+        OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_RANDOM_ACCESS, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+    {
+        std::cerr << "MappedFile: Failed to open " << path << "\n";
+        return false;
+    }
+
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0)
+    {
+        std::cerr << "MappedFile: Empty or unreadable file " << path << "\n";
+        CloseHandle(file);
+        return false;
+    }
+
+    HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    void* view = mapping ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+    if (!view)
+    {
+        std::cerr << "MappedFile: Failed to map " << path << "\n";
+        if (mapping) CloseHandle(mapping);
+        CloseHandle(file);
+        return false;
+    }
+
+    m_file = file;
+    m_mapping = mapping;
+    m_data = static_cast<const uint8_t*>(view);
+    m_size = static_cast<size_t>(fileSize.QuadPart);
+#else
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+    {
+        std::cerr << "MappedFile: Failed to open " << path << "\n";
+        return false;
+    }
+
+    struct stat info;
+    if (fstat(fd, &info) != 0 || info.st_size == 0)
+    {
+        std::cerr << "MappedFile: Empty or unreadable file " << path << "\n";
+        close(fd);
+        return false;
+    }
+
+    void* view = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+    //The mapping keeps the file alive on its own
+    close(fd);
+    if (view == MAP_FAILED)
+    {
+        std::cerr << "MappedFile: Failed to map " << path << "\n";
+        return false;
+    }
+
+    //Loads jump around the bundle, read-ahead past the asset being loaded is mostly wasted
+    madvise(view, static_cast<size_t>(info.st_size), MADV_RANDOM);
+
+    m_data = static_cast<const uint8_t*>(view);
+    m_size = static_cast<size_t>(info.st_size);
+#endif
+    return true;
+}
+
+void MappedFile::Close()
+{
+    if (!m_data) return;
+
+#ifdef _WIN32
+    UnmapViewOfFile(m_data);
+    CloseHandle(m_mapping);
+    CloseHandle(m_file);
+    m_mapping = m_file = nullptr;
+#else
+    munmap(const_cast<uint8_t*>(m_data), m_size);
+#endif
+    m_data = nullptr;
+    m_size = 0;
+}
+
+void MappedFile::Prefetch(const FileRange* ranges, size_t count) const
+{
+    if (!m_data) return;
+
+#ifdef _WIN32
+    //One call for the whole batch, the memory manager queues the reads itself
+    WIN32_MEMORY_RANGE_ENTRY entries[64];
+    size_t entryCount = 0;
+    for (size_t i = 0; i < count; ++i)
+    {
+        ByteSpan span = GetSpan(ranges[i].offset, ranges[i].size);
+        if (span.empty()) continue;
+
+        entries[entryCount++] = { const_cast<uint8_t*>(span.data), span.size };
+        if (entryCount == 64)
+        {
+            PrefetchVirtualMemory(GetCurrentProcess(), entryCount, entries, 0);
+            entryCount = 0;
+        }
+    }
+    if (entryCount != 0)
+        PrefetchVirtualMemory(GetCurrentProcess(), entryCount, entries, 0);
+#else
+    const uintptr_t pageMask = uintptr_t(sysconf(_SC_PAGESIZE)) - 1;
+    for (size_t i = 0; i < count; ++i)
+    {
+        ByteSpan span = GetSpan(ranges[i].offset, ranges[i].size);
+        if (span.empty()) continue;
+
+        //Queues readahead for the range even though the whole mapping is MADV_RANDOM
+        uintptr_t begin = reinterpret_cast<uintptr_t>(span.data) & ~pageMask;
+        uintptr_t end = reinterpret_cast<uintptr_t>(span.data) + span.size;
+        madvise(reinterpret_cast<void*>(begin), end - begin, MADV_WILLNEED);
+    }
+#endif
+}
+
+ByteSpan MappedFile::GetSpan(size_t offset, size_t size) const
+{
+    if (offset > m_size || size > m_size - offset)
+        return {};
+    return ByteSpan{ m_data + offset, size };
+}
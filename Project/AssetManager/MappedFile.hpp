@@ -0,0 +1,49 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include "IResource.hpp"
+
+struct FileRange
+{
+    size_t offset;
+    size_t size;
+};
+
+/*
+* Read-only view of a whole file mapped into memory.
+* Pages are read in by the OS on first touch and shared with the file cache, so slices handed
+* out with GetSpan are zero-copy and stay valid until Close. Any number of threads can read
+* the mapping at the same time without locking.
+*/
+class MappedFile
+{
+public:
+    MappedFile() = default;
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    bool Open(const std::string& path);
+    void Close();
+
+    bool IsOpen() const { return m_data != nullptr; }
+    const uint8_t* GetData() const { return m_data; }
+    size_t GetSize() const { return m_size; }
+
+    // Empty span if the range is not inside the file
+    ByteSpan GetSpan(size_t offset, size_t size) const;
+
+    // Starts reading the ranges into the file cache in the background and returns right away.
+    // Only a hint, the pages are read on first touch either way. Ranges outside the file are skipped
+    void Prefetch(const FileRange* ranges, size_t count) const;
+
+private:
+    const uint8_t* m_data = nullptr;
+    size_t m_size = 0;
+#ifdef _WIN32
+    void* m_file = nullptr;     // HANDLE, kept out of the header so Windows.h is not pulled everywhere
+    void* m_mapping = nullptr;
+#endif
+};
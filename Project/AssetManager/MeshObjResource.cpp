@@ -1,23 +1,38 @@
 #include "MeshObjResource.hpp"
 #include <vector>
-#include <sstream>
+#include <istream>
+#include <streambuf>
 #define TINYOBJLOADER_IMPLEMENTATION
 #include "parser/tiny_obj_loader.h"
 
+namespace
+{
+	//Read-only streambuf over the loaded bytes, lets tinyobj parse them without a string copy
+	class MemoryStreamBuf : public std::streambuf
+	{
+	public:
+		MemoryStreamBuf(const uint8_t* data, size_t size)
+		{
+			char* begin = const_cast<char*>(reinterpret_cast<const char*>(data));
+			setg(begin, begin, begin + size);
+		}
+	};
+}
+
 MeshObj::~MeshObj()
 {
 }
 
-bool MeshObj::Load(const std::vector<uint8_t>& data)
+bool MeshObj::Load(ByteSpan data)
 {
 	//Load mesh :)
-	m_size = data.size();
+	m_size = data.size;
 	std::vector<tinyobj::material_t> materials;
 	std::string warn;
 	std::string err;
 	
-	std::string objText = (char*)data.data();
-	std::istringstream objStream(objText);
+	MemoryStreamBuf objBuffer(data.data, data.size);
+	std::istream objStream(&objBuffer);
 
 	bool ok = tinyobj::LoadObj(&m_attrib, &m_shapes, &materials, &warn, &err, &objStream);
 
@@ -9,7 +9,7 @@ public:
 	MeshObj(std::string GUID) : IResource(GUID, ResourceType::Mesh) {}
 	~MeshObj();
 
-	bool Load(const std::vector<uint8_t>& data) override;
+	bool Load(ByteSpan data) override;
 	bool Unload() override;
 
 	tinyobj::attrib_t GetAttrib() const;
@@ -0,0 +1,85 @@
+#include "PackageFormat.hpp"
+#include <iostream>
+
+namespace
+{
+    bool InFile(uint64_t offset, uint64_t size, uint64_t fileSize)
+    {
+        return offset <= fileSize && size <= fileSize - offset;
+    }
+}
+
+bool PackageToc::Attach(ByteSpan file)
+{
+    m_header = nullptr;
+
+    if (file.size < sizeof(PackageHeader) || (reinterpret_cast<uintptr_t>(file.data) & (alignof(PackageHeader) - 1)) != 0)
+    {
+        std::cerr << "PackageToc: Bundle too small for a header\n";
+        return false;
+    }
+
+    const PackageHeader* header = reinterpret_cast<const PackageHeader*>(file.data);
+    if (header->magic != PackageMagic)
+    {
+        std::cerr << "PackageToc: Not a bundle, rebuild it with PackagingTool\n";
+        return false;
+    }
+    if (header->version != PackageVersion || header->headerSize != sizeof(PackageHeader))
+    {
+        std::cerr << "PackageToc: Bundle version " << header->version << " but expected " << PackageVersion << "\n";
+        return false;
+    }
+    if (header->fileSize != file.size)
+    {
+        std::cerr << "PackageToc: Bundle is " << file.size << " bytes but the header says " << header->fileSize << "\n";
+        return false;
+    }
+
+    bool powerOfTwo = header->bucketCount != 0 && (header->bucketCount & (header->bucketCount - 1)) == 0;
+    bool aligned = header->entriesOffset % alignof(PackageTocEntry) == 0 && header->bucketsOffset % alignof(uint32_t) == 0;
+    if (!powerOfTwo || !aligned || header->bucketCount < header->entryCount
+        || !InFile(header->entriesOffset, uint64_t(header->entryCount) * sizeof(PackageTocEntry), file.size)
+        || !InFile(header->bucketsOffset, uint64_t(header->bucketCount) * sizeof(uint32_t), file.size)
+        || header->namesOffset > file.size)
+    {
+        std::cerr << "PackageToc: Corrupt table of contents\n";
+        return false;
+    }
+
+    m_header = header;
+    m_entries = reinterpret_cast<const PackageTocEntry*>(file.data + header->entriesOffset);
+    m_buckets = reinterpret_cast<const uint32_t*>(file.data + header->bucketsOffset);
+    m_names = reinterpret_cast<const char*>(file.data + header->namesOffset);
+    m_namesSize = file.size - header->namesOffset;
+    return true;
+}
+
+const PackageTocEntry* PackageToc::Find(AssetId id) const
+{
+    if (!m_header)
+        return nullptr;
+
+    uint64_t hash = id.GetValue();
+    uint32_t mask = m_header->bucketCount - 1;
+
+    //Linear probing, the table is never full so an empty bucket always ends the chain
+    for (uint32_t i = 0, bucket = uint32_t(hash) & mask; i <= mask; ++i, bucket = (bucket + 1) & mask)
+    {
+        uint32_t index = m_buckets[bucket];
+        if (index == PackageEmptyBucket || index >= m_header->entryCount)
+            return nullptr;
+
+        const PackageTocEntry& entry = m_entries[index];
+        if (entry.id == hash)
+            return &entry;
+    }
+    return nullptr;
+}
+
+std::string_view PackageToc::GetName(const PackageTocEntry& entry) const
+{
+    if (!InFile(entry.nameOffset, entry.nameLength, m_namesSize))
+        return {};
+    return std::string_view(m_names + entry.nameOffset, entry.nameLength);
+}
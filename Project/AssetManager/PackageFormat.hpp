@@ -0,0 +1,90 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include "AssetId.hpp"
+#include "IResource.hpp"
+
+/*
+* Binary bundle layout, written by PackagingTool and read in place from the mapped file.
+*
+*   PackageHeader
+*   PackageTocEntry[entryCount]     fixed size records
+*   uint32_t buckets[bucketCount]   open addressing table of entry indices, keyed by name hash
+*   char names[]                    asset names, not terminated
+*   payloads                        each aligned to PayloadAlignment, LzCodec compressed when flagged
+*
+* All offsets are 64-bit and from the start of the file, integers are little endian.
+* Finding an asset is a probe or two for its AssetId, nothing is parsed at startup. Ids are
+* unique within a bundle, the names are only kept for resources and debugging.
+*/
+
+constexpr uint32_t PackageMagic = 0x444E4241;    // "ABND"
+constexpr uint16_t PackageVersion = 2;
+constexpr uint32_t PackageEmptyBucket = UINT32_MAX;
+constexpr size_t PackagePayloadAlignment = 16;
+
+// Tells the loader the payload needs a step before the resource sees it
+enum PackageEntryFlags : uint8_t
+{
+    PackageEntryNone = 0,
+    PackageEntryLz = 1 << 0,    // LzCompress output, decompresses to uncompressedSize bytes
+};
+
+constexpr uint8_t PackageKnownEntryFlags = PackageEntryLz;
+
+struct PackageHeader
+{
+    uint32_t magic;
+    uint16_t version;
+    uint16_t headerSize;        // sizeof(PackageHeader) of the writer
+    uint32_t entryCount;
+    uint32_t bucketCount;       // power of two
+    uint64_t entriesOffset;
+    uint64_t bucketsOffset;
+    uint64_t namesOffset;
+    uint64_t fileSize;          // catches truncated bundles
+};
+
+struct PackageTocEntry
+{
+    uint64_t id;                // AssetId of the name
+    uint64_t offset;
+    uint64_t size;              // bytes stored in the bundle
+    uint64_t uncompressedSize;  // size handed to the resource
+    uint32_t nameOffset;        // from namesOffset
+    uint16_t nameLength;
+    uint8_t type;               // ResourceType
+    uint8_t flags;              // PackageEntryFlags
+};
+
+static_assert(sizeof(PackageHeader) == 48, "PackageHeader is part of the file format");
+static_assert(sizeof(PackageTocEntry) == 40, "PackageTocEntry is part of the file format");
+
+// At least twice as many buckets as entries keeps probe chains short
+inline uint32_t PackageBucketCount(uint32_t entryCount)
+{
+    uint32_t count = 16;
+    while (count < entryCount * 2)
+        count <<= 1;
+    return count;
+}
+
+// Read-only view of the table of contents inside a bundle, the bytes must outlive it
+class PackageToc
+{
+public:
+    // Checks the header and that every table lies inside the file
+    bool Attach(ByteSpan file);
+
+    const PackageTocEntry* Find(AssetId id) const;
+    std::string_view GetName(const PackageTocEntry& entry) const;
+    uint32_t GetEntryCount() const { return m_header ? m_header->entryCount : 0; }
+
+private:
+    const PackageHeader* m_header = nullptr;
+    const PackageTocEntry* m_entries = nullptr;
+    const uint32_t* m_buckets = nullptr;
+    const char* m_names = nullptr;
+    size_t m_namesSize = 0;
+};
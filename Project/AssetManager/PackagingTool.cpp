@@ -1,4 +1,6 @@
 #include "PackagingTool.hpp"
+#include "PackageFormat.hpp"
+#include "LzCodec.hpp"
 #include <iostream>
 #include <cstdint>
 #include <fstream>
@@ -58,7 +60,9 @@ bool PackagingTool::readMappingFile(const std::string& path,
 			return false;
 		}
 
-		metaData.uncomp_size = static_cast<uint32_t>(bytes.size());
+		metaData.uncomp_size = bytes.size();
+		metaData.compressed = compressAsset(bytes);
+		metaData.comp_size = bytes.size();
 
 		assetData.push_back(metaData);
 		outData.push_back(std::move(bytes));
@@ -75,39 +79,89 @@ bool PackagingTool::writePackage(const std::string& outputPath,
         return false;
 	}
 
-	std::ofstream out(outputPath, std::ios::binary);
-	if(!out){
-		std::cerr << "Error: Could not stream outputPath" << outputPath << std::endl;
-		return false;
+	const uint32_t entryCount = static_cast<uint32_t>(md.size());
+	const uint32_t bucketCount = PackageBucketCount(entryCount);
+
+	//Names and hash table first, the layout of everything after them depends on their size
+	std::vector<PackageTocEntry> entries(entryCount);
+	std::vector<uint32_t> buckets(bucketCount, PackageEmptyBucket);
+	std::string names;
+
+	for(uint32_t i = 0; i < entryCount; ++i)
+	{
+		if(md[i].guid.size() > UINT16_MAX){
+			std::cerr << "Error: guid too long: " << md[i].guid << std::endl;
+			return false;
+		}
+
+		PackageTocEntry& entry = entries[i];
+		entry.id = HashAssetName(md[i].guid);
+		entry.nameOffset = static_cast<uint32_t>(names.size());
+		entry.nameLength = static_cast<uint16_t>(md[i].guid.size());
+		entry.type = static_cast<uint8_t>(md[i].resourceType);
+		entry.flags = md[i].compressed ? PackageEntryLz : PackageEntryNone;
+		names += md[i].guid;
+
+		uint32_t mask = bucketCount - 1;
+		uint32_t bucket = static_cast<uint32_t>(entry.id) & mask;
+		while(buckets[bucket] != PackageEmptyBucket)
+		{
+			//The loader only compares ids, so two names with the same hash cannot share a bundle either
+			const AssetMetaData& other = md[buckets[bucket]];
+			if(entries[buckets[bucket]].id == entry.id){
+				std::cerr << "Error: " << (other.guid == md[i].guid ? "duplicate guid" : "asset id collision between " + other.guid + " and")
+					<< " in package: " << md[i].guid << std::endl;
+				return false;
+			}
+			bucket = (bucket + 1) & mask;
+		}
+		buckets[bucket] = i;
 	}
-	std::string header = "{\"assets\":[";
 
-	int currentOffset = 0;
+	auto alignUp = [](uint64_t offset) { return (offset + PackagePayloadAlignment - 1) & ~uint64_t(PackagePayloadAlignment - 1); };
+
+	PackageHeader header{};
+	header.magic = PackageMagic;
+	header.version = PackageVersion;
+	header.headerSize = sizeof(PackageHeader);
+	header.entryCount = entryCount;
+	header.bucketCount = bucketCount;
+	header.entriesOffset = sizeof(PackageHeader);
+	header.bucketsOffset = header.entriesOffset + uint64_t(entryCount) * sizeof(PackageTocEntry);
+	header.namesOffset = header.bucketsOffset + uint64_t(bucketCount) * sizeof(uint32_t);
 
-	for(int i = 0; i < md.size(); ++i)
+	uint64_t currentOffset = header.namesOffset + names.size();
+	for(uint32_t i = 0; i < entryCount; ++i)
 	{
+		currentOffset = alignUp(currentOffset);
 		md[i].offset = currentOffset;
 
-		header += 
-			"{\"guid\": \"" + md[i].guid + "\", "
-			"\"type\": " + std::to_string((int)md[i].resourceType) + ", "
-			"\"offset\": " + std::to_string(md[i].offset) + ", "
-			"\"size\": " + std::to_string(md[i].uncomp_size) + " }";
+		entries[i].offset = currentOffset;
+		entries[i].size = md[i].comp_size;
+		entries[i].uncompressedSize = md[i].uncomp_size;
 
-		if(i < md.size() - 1)
-			header += ",";
+		currentOffset += data[i].size();
+	}
+	header.fileSize = currentOffset;
 
-		currentOffset += md[i].uncomp_size;
+	std::ofstream out(outputPath, std::ios::binary);
+	if(!out){
+		std::cerr << "Error: Could not stream outputPath" << outputPath << std::endl;
+		return false;
 	}
-	header += "] }";
 
-	uint32_t headerSize = static_cast<uint32_t>(header.size());
-	out.write(reinterpret_cast<const char*>(&headerSize), sizeof(headerSize));
-	out.write(header.data(), header.size());
+	out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	out.write(reinterpret_cast<const char*>(entries.data()), entries.size() * sizeof(PackageTocEntry));
+	out.write(reinterpret_cast<const char*>(buckets.data()), buckets.size() * sizeof(uint32_t));
+	out.write(names.data(), names.size());
 
+	const char padding[PackagePayloadAlignment] = {};
+	uint64_t written = header.namesOffset + names.size();
 	for(size_t i = 0; i < data.size(); ++i) 
 	{
+		out.write(padding, md[i].offset - written);
 		out.write(reinterpret_cast<const char*>(data[i].data()), data[i].size());
+		written = md[i].offset + data[i].size();
 		if(!out){
 			std::cerr << "Error: failed to write ..." << std::endl;
 			return false;
@@ -143,6 +197,21 @@ bool PackagingTool::loadAssetFile(const std::string& path, std::vector<uint8_t>&
 	return true;
 }
 
+bool PackagingTool::compressAsset(std::vector<uint8_t>& bytes)
+{
+	std::vector<uint8_t> compressed(LzCompressBound(bytes.size()));
+	size_t size = LzCompress(ByteSpan{ bytes.data(), bytes.size() }, compressed.data(), compressed.size());
+
+	//PNGs are already deflated, saving a few percent on them is not worth a decode on every load
+	if(size == 0 || size > bytes.size() - bytes.size() / 8){
+		return false;
+	}
+
+	compressed.resize(size);
+	bytes = std::move(compressed);
+	return true;
+}
+
 ResourceType PackagingTool::parseType(const std::string& type)
 {
 	ResourceType resourceType;
@@ -12,6 +12,7 @@ struct AssetMetaData
 	size_t uncomp_size = 0;
 
 	size_t comp_size = 0;
+	bool compressed = false;
 
 	size_t offset = 0;
 
@@ -26,6 +27,8 @@ private:
 	bool readMappingFile(const std::string& path,std::vector<AssetMetaData>& assetData, std::vector<std::vector<uint8_t>>& outData);
 	bool writePackage(const std::string& outputPath, std::vector<AssetMetaData>& metadata, const std::vector<std::vector<uint8_t>>& data);
 	bool loadAssetFile(const std::string& path, std::vector<uint8_t>& outBytes);
+	// Replaces bytes with their LzCodec compression when that saves enough to be worth decoding
+	bool compressAsset(std::vector<uint8_t>& bytes);
 	
 	ResourceType parseType(const std::string& type);
 
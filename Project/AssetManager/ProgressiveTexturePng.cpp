@@ -1,5 +1,7 @@
 #include "ProgressiveTexturePng.hpp"
 #include "raylib.h"
+#include "../MemoryManager/MemoryTracking.hpp"
+#include "../MemoryManager/Memory.hpp"
 
 std::string ProgressiveTexturePng::GetNextLODGuid() const
 {
@@ -14,15 +16,22 @@ std::string ProgressiveTexturePng::GetNextLODGuid() const
     return baseGuid + "_lod" + std::to_string(m_currentLOD + 1);
 }
 
-bool ProgressiveTexturePng::Load(const std::vector<uint8_t>& data)
+bool ProgressiveTexturePng::Load(ByteSpan data)
 {
-    m_size = data.size();
-    Image img = LoadImageFromMemory(".png", data.data(), m_size);
+    Image img = LoadImageFromMemory(".png", data.data, static_cast<int>(data.size));
     if (!img.data) return false;
 
     size_t imgSize = img.width * img.height * 4;
-    m_imageData = (unsigned char*)malloc(imgSize);
+    m_imageData = (unsigned char*)TlsfAlloc(imgSize);
+    if (!m_imageData)
+    {
+        UnloadImage(img);
+        return false;
+    }
     memcpy(m_imageData, img.data, imgSize);
+    MEM_TRACK_ALLOC(MemoryTag::ResourcePayload, imgSize);
+    //Decoded pixels are what stays resident, AssetManager budgets by this
+    m_size = imgSize;
 
     m_width = img.width;
     m_height = img.height;
@@ -63,12 +72,13 @@ void ProgressiveTexturePng::SwapToHigherLOD()
     if (m_pendingImage.empty()) return;
 
     if (m_imageData) {
-        free(m_imageData);
+        MEM_TRACK_FREE(MemoryTag::ResourcePayload, static_cast<size_t>(m_width) * m_height * 4);
+        TlsfDeAlloc(m_imageData);
         m_imageData = nullptr;
     }
 
     size_t newSize = m_pendingImage.size();
-    m_imageData = (unsigned char*)malloc(newSize);
+    m_imageData = (unsigned char*)TlsfAlloc(newSize);
     if (!m_imageData) 
     {
         m_pendingImage.clear();
@@ -76,6 +86,7 @@ void ProgressiveTexturePng::SwapToHigherLOD()
     }
 
     memcpy(m_imageData, m_pendingImage.data(), newSize);
+    MEM_TRACK_ALLOC(MemoryTag::ResourcePayload, newSize);
 
     m_width = m_pendingW;
     m_height = m_pendingH;
@@ -90,7 +101,8 @@ void ProgressiveTexturePng::SwapToHigherLOD()
 bool ProgressiveTexturePng::Unload()
 {
     if (m_imageData) {
-        free(m_imageData);
+        MEM_TRACK_FREE(MemoryTag::ResourcePayload, static_cast<size_t>(m_width) * m_height * 4);
+        TlsfDeAlloc(m_imageData);
         m_imageData = nullptr;
     }
     m_pendingImage.clear();
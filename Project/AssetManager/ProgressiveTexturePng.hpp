@@ -1,6 +1,7 @@
 
 #pragma once
 #include "IResource.hpp"
+#include <cstdint>
 #include <vector>
 #include <string>
 
@@ -10,7 +11,7 @@ public:
     ProgressiveTexturePng(const std::string& guid) : IResource(guid, ResourceType::ProgressiveTexturePng) {}
     ~ProgressiveTexturePng() override { Unload(); }
 
-    bool Load(const std::vector<uint8_t>& data) override;
+    bool Load(ByteSpan data) override;
     bool Unload() override;
 
     // Progressive loading
@@ -44,7 +45,6 @@ private:
     int m_width = 0;
     int m_height = 0;
     int m_channels = 0;
-    size_t m_size = 0;
 
     // Pending higher LOD
     std::vector<unsigned char> m_pendingImage;
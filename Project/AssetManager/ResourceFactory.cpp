@@ -2,6 +2,7 @@
 #include "TexturePngResource.hpp"
 #include "MeshObjResource.hpp"
 #include "ProgressiveTexturePng.hpp"
+#include "../MemoryManager/SmallObjectAllocator.hpp"
 #include <iostream>
 
 std::shared_ptr<IResource> ResourceFactory::Create(const std::string& guid, ResourceType type)
@@ -9,14 +10,14 @@ std::shared_ptr<IResource> ResourceFactory::Create(const std::string& guid, Reso
     switch (type)
     {
     case ResourceType::TexturePng:
-        return std::make_shared<TexturePng>(guid);
+        return std::allocate_shared<TexturePng>(SmallObjectStlAllocator<TexturePng>(), guid);
 
     case ResourceType::Mesh:
-        return std::make_shared<MeshObj>(guid);
+        return std::allocate_shared<MeshObj>(SmallObjectStlAllocator<MeshObj>(), guid);
         return nullptr;
 
     case ResourceType::ProgressiveTexturePng:
-        return std::make_shared<ProgressiveTexturePng>(guid);
+        return std::allocate_shared<ProgressiveTexturePng>(SmallObjectStlAllocator<ProgressiveTexturePng>(), guid);
      
     default:
         std::cerr << "ResourceFactory: Unsupported resource type\n";
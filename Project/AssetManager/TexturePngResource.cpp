@@ -1,5 +1,7 @@
 #include "TexturePngResource.hpp"
 #include "raylib.h"
+#include "../MemoryManager/MemoryTracking.hpp"
+#include "../MemoryManager/Memory.hpp"
 
 
 TexturePng::~TexturePng()
@@ -7,9 +9,9 @@ TexturePng::~TexturePng()
 	Unload();
 }
 
-bool TexturePng::Load(const std::vector<uint8_t>& data)
+bool TexturePng::Load(ByteSpan data)
 {
-	Image img = LoadImageFromMemory(".png", data.data(), (int)data.size());
+	Image img = LoadImageFromMemory(".png", data.data, (int)data.size);
 
 	if (img.data == nullptr || img.width <= 0 || img.height <= 0)
 	{
@@ -27,8 +29,9 @@ bool TexturePng::Load(const std::vector<uint8_t>& data)
 		return false;
 	}
 
-	m_imageData = (unsigned char*)malloc(imgSize);
-	if (imgSize <= 0)
+	//Pixel buffers come and go with streaming, the TLSF heap reuses them without fragmenting
+	m_imageData = (unsigned char*)TlsfAlloc(imgSize);
+	if (!m_imageData)
 	{
 		UnloadImage(img);
 		return false;
@@ -39,6 +42,7 @@ bool TexturePng::Load(const std::vector<uint8_t>& data)
 	m_height = img.height;
 	m_channels = 4;
 	m_size = (size_t)imgSize;
+	MEM_TRACK_ALLOC(MemoryTag::ResourcePayload, m_size);
 
 	UnloadImage(img);
 
@@ -50,7 +54,8 @@ bool TexturePng::Unload()
 	//unload un texture
 	if (m_imageData)
 	{
-		//free(m_imageData);
+		MEM_TRACK_FREE(MemoryTag::ResourcePayload, m_size);
+		TlsfDeAlloc(m_imageData);
 		m_imageData = nullptr;
 		m_height = m_width = m_channels = m_size = 0;
 		return true;
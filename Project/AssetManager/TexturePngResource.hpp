@@ -9,7 +9,7 @@ public:
 	TexturePng(std::string GUID) : IResource(GUID, ResourceType::TexturePng) {}
 	~TexturePng();
 
-	bool Load(const std::vector<uint8_t>& data) override;
+	bool Load(ByteSpan data) override;
 	bool Unload() override;
 
 	const unsigned char* GetTexture();
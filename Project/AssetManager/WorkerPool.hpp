@@ -0,0 +1,166 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <memory_resource>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+/*
+* Fixed set of threads running Jobs with a shared handler.
+* Every worker owns a deque: Submit deals jobs out round robin, a worker takes from the front of
+* its own deque and, once that is empty, steals from the back of the others. A burst of loads is
+* therefore spread over all workers, and a worker stuck on one big decode does not hold back
+* the jobs queued behind it. Queued jobs are still run when the pool is destroyed.
+*/
+template<typename Job>
+class WorkerPool
+{
+public:
+    using Handler = std::function<void(Job&)>;
+
+    // workerCount 0 picks one worker per hardware thread, minus the main thread
+    WorkerPool(size_t workerCount, Handler handler, std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+        : m_handler(std::move(handler))
+    {
+        if (workerCount == 0)
+            workerCount = DefaultWorkerCount();
+
+        m_queues.reserve(workerCount);
+        for (size_t i = 0; i < workerCount; ++i)
+            m_queues.push_back(std::make_unique<WorkerQueue>(resource));
+
+        m_threads.reserve(workerCount);
+        for (size_t i = 0; i < workerCount; ++i)
+            m_threads.emplace_back(&WorkerPool::WorkerLoop, this, i);
+    }
+
+    ~WorkerPool()
+    {
+        {
+            std::scoped_lock lock(m_sleepMutex);
+            m_stop = true;
+        }
+        m_wake.notify_all();
+
+        for (std::thread& thread : m_threads)
+        {
+            if (thread.joinable())
+                thread.join();
+        }
+    }
+
+    WorkerPool(const WorkerPool&) = delete;
+    WorkerPool& operator=(const WorkerPool&) = delete;
+
+    void Submit(Job job)
+    {
+        //Counted before it is visible, so a worker never pops a job the count does not include yet.
+        //Under the sleep mutex so a worker about to wait cannot miss it
+        {
+            std::scoped_lock lock(m_sleepMutex);
+            ++m_queued;
+        }
+
+        size_t index = m_nextQueue.fetch_add(1, std::memory_order_relaxed) % m_queues.size();
+        {
+            WorkerQueue& queue = *m_queues[index];
+            std::scoped_lock lock(queue.mutex);
+            queue.jobs.push_back(std::move(job));
+        }
+        m_wake.notify_one();
+    }
+
+    size_t GetWorkerCount() const { return m_threads.size(); }
+    size_t GetQueuedCount() const { return m_queued.load(std::memory_order_relaxed); }
+    size_t GetStealCount() const { return m_steals.load(std::memory_order_relaxed); }
+
+    static size_t DefaultWorkerCount()
+    {
+        unsigned hardware = std::thread::hardware_concurrency();
+        return hardware > 1 ? hardware - 1 : 1;
+    }
+
+private:
+    //Own cache line each, workers lock their own queue on every job
+    struct alignas(64) WorkerQueue
+    {
+        explicit WorkerQueue(std::pmr::memory_resource* resource) : jobs(resource) {}
+
+        std::mutex mutex;
+        std::pmr::deque<Job> jobs;
+    };
+
+    Handler m_handler;
+    std::vector<std::unique_ptr<WorkerQueue>> m_queues;
+    std::vector<std::thread> m_threads;
+
+    std::mutex m_sleepMutex;
+    std::condition_variable m_wake;
+    std::atomic<size_t> m_queued{ 0 };
+    std::atomic<size_t> m_nextQueue{ 0 };
+    std::atomic<size_t> m_steals{ 0 };
+    bool m_stop = false;
+
+    bool TryPop(size_t self, Job& outJob)
+    {
+        {
+            WorkerQueue& own = *m_queues[self];
+            std::scoped_lock lock(own.mutex);
+            if (!own.jobs.empty())
+            {
+                outJob = std::move(own.jobs.front());
+                own.jobs.pop_front();
+                return true;
+            }
+        }
+
+        //Steal the newest job of the next worker over, that is the one its owner would reach last
+        for (size_t i = 1; i < m_queues.size(); ++i)
+        {
+            WorkerQueue& victim = *m_queues[(self + i) % m_queues.size()];
+            std::scoped_lock lock(victim.mutex);
+            if (!victim.jobs.empty())
+            {
+                outJob = std::move(victim.jobs.back());
+                victim.jobs.pop_back();
+                m_steals.fetch_add(1, std::memory_order_relaxed);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void WorkerLoop(size_t self)
+    {
+        while (true)
+        {
+            Job job;
+            if (TryPop(self, job))
+            {
+                m_queued.fetch_sub(1, std::memory_order_relaxed);
+                m_handler(job);
+                continue;
+            }
+
+            std::unique_lock lock(m_sleepMutex);
+            if (m_stop && m_queued.load() == 0)
+                return;
+
+            //A counted job may not be pushed yet or may be popped but not uncounted yet, only sleep when nothing is counted
+            if (m_queued.load() == 0)
+                m_wake.wait(lock, [this]() { return m_stop || m_queued.load() != 0; });
+            else
+            {
+                lock.unlock();
+                std::this_thread::yield();
+            }
+        }
+    }
+};
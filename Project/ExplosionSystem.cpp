@@ -1,10 +1,11 @@
 #include "ExplosionSystem.hpp"
-#include "MemoryManager/StackAllocator.hpp"
+#include "MemoryManager/FrameAllocator.hpp"
 #include <algorithm>
 #include <cmath>
 
-ExplosionSystem::ExplosionSystem(StackAllocator& frameAllocator)
-    : m_frameAllocator(frameAllocator)
+ExplosionSystem::ExplosionSystem(FrameAllocator& frameAllocator, std::pmr::memory_resource* resource)
+    : m_frameAllocator(frameAllocator),
+    m_explosions(resource)
 {
     m_explosions.reserve(50);
 }
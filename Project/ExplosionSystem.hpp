@@ -1,9 +1,10 @@
 #pragma once
 #include "raylib.h"
 #include <vector>
+#include <memory_resource>
 #include <cstddef>
 
-class StackAllocator;
+class FrameAllocator;
 
 struct Explosion
 {
@@ -23,19 +24,20 @@ struct ExplosionVertex
 class ExplosionSystem
 {
 public:
-    ExplosionSystem(StackAllocator& frameAllocator);
+    ExplosionSystem(FrameAllocator& frameAllocator, std::pmr::memory_resource* resource = std::pmr::get_default_resource());
     ~ExplosionSystem();
 
     void AddExplosion(const Vector3& position, float radius, float duration);
     void Update(float dt);
+    // Vertex data lives in the current frame buffer, valid until that frame is released
     void BuildRendererData();
 
     const ExplosionVertex* GetVertices() const {return m_vertices; }
     size_t GetVertexCount() const {return m_vertexCounter; }
 
 private:
-    StackAllocator& m_frameAllocator;
-    std::vector<Explosion> m_explosions;
+    FrameAllocator& m_frameAllocator;
+    std::pmr::vector<Explosion> m_explosions;
 
     ExplosionVertex* m_vertices = nullptr;
     size_t m_vertexCounter = 0;
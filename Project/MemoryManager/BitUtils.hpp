@@ -0,0 +1,47 @@
+#pragma once
+#include <cstdint>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+// Index of the highest set bit, value must not be 0
+inline uint32_t FindLastSet(uint64_t value)
+{
+#if defined(_MSC_VER) && defined(_WIN64)
+	unsigned long index;
+	_BitScanReverse64(&index, value);
+	return index;
+#elif defined(_MSC_VER)
+	unsigned long index;
+	if (_BitScanReverse(&index, static_cast<uint32_t>(value >> 32)))
+		return index + 32;
+	_BitScanReverse(&index, static_cast<uint32_t>(value));
+	return index;
+#else
+	return 63 - __builtin_clzll(value);
+#endif
+}
+
+// Index of the lowest set bit, value must not be 0
+inline uint32_t FindFirstSet(uint64_t value)
+{
+#if defined(_MSC_VER) && defined(_WIN64)
+	unsigned long index;
+	_BitScanForward64(&index, value);
+	return index;
+#elif defined(_MSC_VER)
+	unsigned long index;
+	if (_BitScanForward(&index, static_cast<uint32_t>(value)))
+		return index;
+	_BitScanForward(&index, static_cast<uint32_t>(value >> 32));
+	return index + 32;
+#else
+	return __builtin_ctzll(value);
+#endif
+}
+
+// Smallest n with (1 << n) >= value
+inline uint32_t CeilLog2(uint64_t value)
+{
+	return value <= 1 ? 0 : FindLastSet(value - 1) + 1;
+}
@@ -1,155 +1,314 @@
 #include "BuddyAllocator.hpp"
+#include "BitUtils.hpp"
+#include "MemoryTrace.hpp"
+#include <cstdlib>
+#include <new>
 
-BuddyAllocator::BuddyAllocator(size_t minBlockSize, size_t totalSize)
-	:m_minBlockSize(minBlockSize), m_totalSize(totalSize)
+BuddyAllocator::BuddyAllocator(size_t minBlockSize, size_t totalSize, ArenaBacking backing)
+	: m_backing(backing)
 {
-	m_basePtr = malloc(totalSize);
-	int maxLevel = GetLevelForSize(totalSize);
-	m_freeblocks.resize(maxLevel + 1);
-	m_freeblocks[maxLevel].push_back(m_basePtr);
-	m_blocklevel.resize(m_totalSize / m_minBlockSize);
+	//Free blocks store their list links in place so they must fit
+	if (minBlockSize < sizeof(FreeBlock))
+		minBlockSize = sizeof(FreeBlock);
+
+	m_minBlockShift = CeilLog2(minBlockSize);
+	m_minBlockSize = size_t(1) << m_minBlockShift;
+
+	if (totalSize < m_minBlockSize)
+		throw std::bad_alloc();
+
+	//Only whole top level blocks can be managed, round down to a power of two multiple
+	m_maxLevel = FindLastSet(totalSize >> m_minBlockShift);
+	m_totalSize = m_minBlockSize << m_maxLevel;
+
+	if (m_backing == ArenaBacking::VirtualMemory)
+	{
+		m_pageSize = VirtualMemory::GetPageSize();
+		m_basePtr = static_cast<char*>(VirtualMemory::Reserve(m_totalSize));
+		size_t pageCount = (m_totalSize + m_pageSize - 1) / m_pageSize;
+		m_committedBits.assign((pageCount + 63) / 64, 0);
+	}
+	else
+	{
+		m_pageSize = 1;
+		m_basePtr = static_cast<char*>(malloc(m_totalSize));
+		m_committedPages = m_peakCommittedPages = m_totalSize;
+	}
+	if (!m_basePtr)
+		throw std::bad_alloc();
+
+	m_freeLists.assign(m_maxLevel + 1, nullptr);
+	m_freeBits.resize(m_maxLevel + 1);
+	for (uint32_t level = 0; level <= m_maxLevel; ++level)
+	{
+		uint64_t blockCount = uint64_t(1) << (m_maxLevel - level);
+		m_freeBits[level].assign((blockCount + 63) / 64, 0);
+	}
+	m_allocatedBits = m_freeBits;
+
+	PushFree(m_maxLevel, 0);
 }
 
 BuddyAllocator::~BuddyAllocator()
 {
-	free(m_basePtr);
+	if (m_backing == ArenaBacking::VirtualMemory)
+		VirtualMemory::Release(m_basePtr, m_totalSize);
+	else
+		free(m_basePtr);
 }
 
 void* BuddyAllocator::Allocate(size_t size)
 {
 	if (size > m_totalSize) return nullptr;
 
-	int level = GetLevelForSize(size);
-	Split(level);
-	if (m_freeblocks[level].empty())
+	uint32_t level = GetLevelForSize(size);
+
+	//Smallest level at or above the request with a free block
+	uint64_t candidates = m_nonEmptyLevels >> level;
+	if (candidates == 0)
 	{
 		//no more memory to give :(
 		return nullptr;
 	}
-	void* blkptr = m_freeblocks[level].back();
-	m_freeblocks[level].pop_back();
+	uint32_t freeLevel = level + FindFirstSet(candidates);
 
-	//add to list
-	size_t offset = (char*)blkptr - (char*)m_basePtr;
-	m_blocklevel[offset / m_minBlockSize] = level;
+	return TakeBlock(freeLevel, m_freeLists[freeLevel], level, size);
+}
+
+void* BuddyAllocator::AllocateBelow(size_t size, const void* limit)
+{
+	if (size > m_totalSize) return nullptr;
 
-	//Get the level needed for allocation size
-	//Run split
-	//Check if still empty (no memory left)
-	//if not empty pop and return pointer
+	uint32_t level = GetLevelForSize(size);
+	uint64_t limitOffset = uint64_t(static_cast<const char*>(limit) - m_basePtr);
 
-	return blkptr;
+	for (uint64_t levels = m_nonEmptyLevels >> level; levels != 0; levels &= levels - 1)
+	{
+		uint32_t freeLevel = level + FindFirstSet(levels);
+		uint64_t offset;
+		if (FindLowestFree(freeLevel, limitOffset, offset))
+			return TakeBlock(freeLevel, reinterpret_cast<FreeBlock*>(m_basePtr + offset), level, size);
+	}
+	return nullptr;
 }
 
-void BuddyAllocator::Deallocate(void* ptr)
+float BuddyAllocator::GetFragmentation() const
 {
-	size_t offset = (char*)ptr - (char*)m_basePtr;
-	int level = m_blocklevel[offset / m_minBlockSize];
-	Merge(level, offset);
+	size_t freeBytes = m_totalSize - m_allocatedBytes;
+	if (freeBytes == 0)
+		return 0.0f;
+	return 1.0f - float(GetLargestFreeBlock()) / float(freeBytes);
 }
 
-int BuddyAllocator::GetLevelForSize(size_t size)
+void* BuddyAllocator::TakeBlock(uint32_t freeLevel, FreeBlock* block, uint32_t level, [[maybe_unused]] size_t size)
 {
-	int level = 0;
-	int blocksize = GetBlockSizeForLevel(level);
-	while (size > blocksize)
+	uint64_t offset = uint64_t(reinterpret_cast<char*>(block) - m_basePtr);
+	RemoveFree(freeLevel, block, offset);
+
+	//Split down, the upper half goes back to the free list of each level
+	while (freeLevel > level)
 	{
-		level += 1;
-		blocksize = GetBlockSizeForLevel(level);
+		--freeLevel;
+		PushFree(freeLevel, offset + GetBlockSizeForLevel(freeLevel));
 	}
-	return level;
-}
 
-size_t BuddyAllocator::GetBlockSizeForLevel(size_t level)
-{
-	size_t size = m_minBlockSize;
-	for (int i = 0; i < level; i++)
+	SetAllocated(level, offset, true);
+
+	//Tracked before the commit so the failure path can go through Deallocate
+	MEM_TRACK_ALLOC(MemoryTag::Buddy, GetBlockSizeForLevel(level));
+	m_allocatedBytes += GetBlockSizeForLevel(level);
+
+	if (!CommitRange(offset, GetBlockSizeForLevel(level)))
 	{
-		size = size * 2;
+		Deallocate(m_basePtr + offset);
+		return nullptr;
 	}
-	return size;
+
+	MEM_TRACE_ALLOC(MemoryTag::Buddy, this, m_basePtr + offset, size, 0);
+	return m_basePtr + offset;
 }
 
-void BuddyAllocator::Split(int level)
+void BuddyAllocator::Deallocate(void* ptr)
 {
-	if (!m_freeblocks[level].empty())
+	if (!ptr) return;
+
+	uint64_t offset = uint64_t(static_cast<char*>(ptr) - m_basePtr);
+	if (offset >= m_totalSize || (offset & (m_minBlockSize - 1)) != 0)
 	{
+		std::cout << "[Buddy] ERROR: pointer does not belong to this allocator\n";
 		return;
 	}
 
-	int maxlevel = m_freeblocks.size() - 1;
-	if (level >= maxlevel)
+	//Handed out blocks never overlap, so at most one level has one starting here. Only levels the offset is aligned to can
+	uint32_t level = 0;
+	while (!IsAllocated(level, offset))
 	{
-		//out of memory
-		return;
+		++level;
+		if (level > m_maxLevel || (offset & (GetBlockSizeForLevel(level) - 1)) != 0)
+		{
+			std::cout << "[Buddy] ERROR: double free or pointer inside a block\n";
+			return;
+		}
 	}
+	SetAllocated(level, offset, false);
+	MEM_TRACK_FREE(MemoryTag::Buddy, GetBlockSizeForLevel(level));
+	m_allocatedBytes -= GetBlockSizeForLevel(level);
+	MEM_TRACE_FREE(MemoryTag::Buddy, this, ptr);
 
-	Split(level + 1);
-
-	if (m_freeblocks[level + 1].empty())
+	//Merge upwards while the buddy is free, the XOR trick gives the buddy offset
+	while (level < m_maxLevel)
 	{
-		//cannot split parent is also out of memory
-		return;
+		uint64_t buddyOffset = offset ^ GetBlockSizeForLevel(level);
+		if (!IsFree(level, buddyOffset))
+			break;
+
+		RemoveFree(level, reinterpret_cast<FreeBlock*>(m_basePtr + buddyOffset), buddyOffset);
+		offset = offset < buddyOffset ? offset : buddyOffset;
+		++level;
 	}
 
-	void* parentBlk = m_freeblocks[level + 1].back();
-	m_freeblocks[level + 1].pop_back();
-	size_t halfPoint = GetBlockSizeForLevel(level);
+	//Give big free blocks back to the OS, the first page keeps the free list links
+	size_t blockSize = GetBlockSizeForLevel(level);
+	if (m_backing == ArenaBacking::VirtualMemory && blockSize >= DecommitThreshold && blockSize > m_pageSize &&
+		GetCommittedBytes() > m_allocatedBytes + RetainedFreeBytes)
+		DecommitRange(offset + m_pageSize, blockSize - m_pageSize);
 
-	char* child1 = (char*)parentBlk;
-	char* child2 = child1 + halfPoint;
+	PushFree(level, offset);
+}
+
+uint32_t BuddyAllocator::GetLevelForSize(size_t size) const
+{
+	uint32_t shift = CeilLog2(size);
+	return shift <= m_minBlockShift ? 0 : shift - m_minBlockShift;
+}
+
+void BuddyAllocator::PushFree(uint32_t level, uint64_t offset)
+{
+	CommitRange(offset, sizeof(FreeBlock));
+
+	FreeBlock* block = reinterpret_cast<FreeBlock*>(m_basePtr + offset);
+	block->prev = nullptr;
+	block->next = m_freeLists[level];
+	if (block->next)
+		block->next->prev = block;
+	m_freeLists[level] = block;
+
+	uint64_t index = BlockIndex(offset, level);
+	m_freeBits[level][index >> 6] |= uint64_t(1) << (index & 63);
+	m_nonEmptyLevels |= uint64_t(1) << level;
+}
+
+void BuddyAllocator::RemoveFree(uint32_t level, FreeBlock* block, uint64_t offset)
+{
+	if (block->prev)
+		block->prev->next = block->next;
+	else
+		m_freeLists[level] = block->next;
+	if (block->next)
+		block->next->prev = block->prev;
+
+	uint64_t index = BlockIndex(offset, level);
+	m_freeBits[level][index >> 6] &= ~(uint64_t(1) << (index & 63));
+	if (!m_freeLists[level])
+		m_nonEmptyLevels &= ~(uint64_t(1) << level);
+}
+
+bool BuddyAllocator::IsFree(uint32_t level, uint64_t offset) const
+{
+	uint64_t index = BlockIndex(offset, level);
+	return (m_freeBits[level][index >> 6] >> (index & 63)) & 1;
+}
 
-	m_freeblocks[level].push_back(child1);
-	m_freeblocks[level].push_back(child2);
+bool BuddyAllocator::IsAllocated(uint32_t level, uint64_t offset) const
+{
+	uint64_t index = BlockIndex(offset, level);
+	return (m_allocatedBits[level][index >> 6] >> (index & 63)) & 1;
+}
+
+void BuddyAllocator::SetAllocated(uint32_t level, uint64_t offset, bool allocated)
+{
+	uint64_t index = BlockIndex(offset, level);
+	if (allocated)
+		m_allocatedBits[level][index >> 6] |= uint64_t(1) << (index & 63);
+	else
+		m_allocatedBits[level][index >> 6] &= ~(uint64_t(1) << (index & 63));
+}
+
+bool BuddyAllocator::FindLowestFree(uint32_t level, uint64_t endOffset, uint64_t& outOffset) const
+{
+	//Blocks starting below endOffset, the free lists are unordered so the bitmap is scanned a word at a time
+	uint32_t shift = m_minBlockShift + level;
+	uint64_t endIndex = (endOffset + GetBlockSizeForLevel(level) - 1) >> shift;
+	const std::vector<uint64_t>& bits = m_freeBits[level];
+
+	for (uint64_t word = 0; word * 64 < endIndex; ++word)
+	{
+		if (bits[word] == 0)
+			continue;
 
-	//check if free block exists on level (if yes return, if no continue)
-	//If we are at highest level no more memory
-	//recurssion on level + 1
-	//pop one parent block
-	//add 2 children blocks
+		uint64_t index = word * 64 + FindFirstSet(bits[word]);
+		if (index >= endIndex)
+			return false;
+		outOffset = index << shift;
+		return true;
+	}
+	return false;
 }
 
-void BuddyAllocator::Merge(int level, int offset)
+bool BuddyAllocator::CommitRange(uint64_t offset, size_t size)
 {
-    int currentLevel = level;
-    int currentOffset = offset;
+	if (m_backing != ArenaBacking::VirtualMemory)
+		return true;
 
-    while (currentLevel < m_freeblocks.size() - 1)
-    {
-        size_t blockSize = GetBlockSizeForLevel(currentLevel);
+	uint64_t firstPage = offset / m_pageSize;
+	uint64_t lastPage = (offset + size - 1) / m_pageSize;
 
-        //Compute buddy offset using XOR trick
-        int buddyOffset = currentOffset ^ blockSize;
-        void* buddyPtr = (char*)m_basePtr + buddyOffset;
+	//Commit runs of uncommitted pages with one call each
+	uint64_t page = firstPage;
+	while (page <= lastPage)
+	{
+		if ((m_committedBits[page >> 6] >> (page & 63)) & 1)
+		{
+			++page;
+			continue;
+		}
 
-        bool buddyFree = false;
-        auto& list = m_freeblocks[currentLevel];
+		uint64_t runStart = page;
+		while (page <= lastPage && !((m_committedBits[page >> 6] >> (page & 63)) & 1))
+		{
+			m_committedBits[page >> 6] |= uint64_t(1) << (page & 63);
+			++page;
+		}
 
-        for (int i = 0; i < list.size(); i++)
-        {
-            if (list[i] == buddyPtr)
-            {
-                buddyFree = true;
-                list[i] = list.back();
-                list.pop_back();
-                break;
-            }
-        }
+		if (!VirtualMemory::Commit(m_basePtr + runStart * m_pageSize, (page - runStart) * m_pageSize))
+		{
+			for (uint64_t undo = runStart; undo < page; ++undo)
+				m_committedBits[undo >> 6] &= ~(uint64_t(1) << (undo & 63));
+			return false;
+		}
+		m_committedPages += page - runStart;
+	}
 
-        if (!buddyFree)
-        {
-            //Buddy isnt free stop
-            m_freeblocks[currentLevel].push_back((char*)m_basePtr + currentOffset);
-            return;
-        }
+	if (m_committedPages > m_peakCommittedPages)
+		m_peakCommittedPages = m_committedPages;
+	return true;
+}
 
-        int parentOffset = std::min(currentOffset, buddyOffset);
+void BuddyAllocator::DecommitRange(uint64_t offset, size_t size)
+{
+	uint64_t firstPage = offset / m_pageSize;
+	uint64_t endPage = (offset + size) / m_pageSize;
 
-        //Next level
-        currentLevel++;
-        currentOffset = parentOffset;
-    }
+	for (uint64_t page = firstPage; page < endPage; ++page)
+	{
+		uint64_t& word = m_committedBits[page >> 6];
+		uint64_t bit = uint64_t(1) << (page & 63);
+		if (word & bit)
+		{
+			word &= ~bit;
+			--m_committedPages;
+		}
+	}
 
-    //Insert final merged block
-    m_freeblocks[currentLevel].push_back((char*)m_basePtr + currentOffset);
+	VirtualMemory::Decommit(m_basePtr + offset, size);
 }
@@ -1,26 +1,82 @@
 #pragma once
 #include <iostream>
+#include <cstdint>
 #include <vector>
+#include "VirtualMemory.hpp"
+#include "MemoryTracking.hpp"
+#include "BitUtils.hpp"
 
+/*
+* Binary buddy allocator.
+* Free blocks are kept in intrusive doubly linked lists (the links live inside the free block),
+* a per level bitmap tells if a block is free so the buddy check and unlink are O(1).
+* With ArenaBacking::VirtualMemory the arena is only reserved, blocks are committed when handed out
+* and large merged free blocks are decommitted again (except the page holding the list links).
+*/
 class BuddyAllocator
 {
 public:
-	BuddyAllocator(size_t minBlockSize, size_t totalSize);
+	BuddyAllocator(size_t minBlockSize, size_t totalSize, ArenaBacking backing = ArenaBacking::Heap);
 	~BuddyAllocator();
 
+	BuddyAllocator(const BuddyAllocator&) = delete;
+	BuddyAllocator& operator=(const BuddyAllocator&) = delete;
+
 	void* Allocate(size_t size);
+	//Free block below limit, nullptr if there is none. Used to pack blocks during compaction.
+	//Takes the lowest one of the smallest level that has any, so a same size slot is used before a bigger block is split
+	void* AllocateBelow(size_t size, const void* limit);
 	void Deallocate(void* ptr);
 
+	size_t GetTotalSize() const { return m_totalSize; }
+	size_t GetMinBlockSize() const { return m_minBlockSize; }
+	size_t GetAllocatedBytes() const { return m_allocatedBytes; }	//sum of handed out block sizes
+	size_t GetCommittedBytes() const { return m_committedPages * m_pageSize; }
+	size_t GetPeakCommittedBytes() const { return m_peakCommittedPages * m_pageSize; }
+	size_t GetLargestFreeBlock() const { return m_nonEmptyLevels ? GetBlockSizeForLevel(FindLastSet(m_nonEmptyLevels)) : 0; }
+	//1 - largest free block / free bytes, 0 when all free memory is one block
+	float GetFragmentation() const;
+
 private:
-	size_t m_minBlockSize;	//Smallest allowed block
+	struct FreeBlock
+	{
+		FreeBlock* prev;
+		FreeBlock* next;
+	};
+
+	size_t m_minBlockSize;	//Smallest allowed block (power of two)
 	size_t m_totalSize;		//total size of all blocks
-	void* m_basePtr;		//raw memory block
+	char* m_basePtr;		//raw memory block
+	uint32_t m_minBlockShift;
+	uint32_t m_maxLevel;
+
+	std::vector<FreeBlock*> m_freeLists;			//per level list head
+	std::vector<std::vector<uint64_t>> m_freeBits;	//per level, bit set = block is in the free list
+	std::vector<std::vector<uint64_t>> m_allocatedBits;	//per level, bit set = a handed out block starts there
+	uint64_t m_nonEmptyLevels = 0;					//bit set = free list of that level has blocks
+	size_t m_allocatedBytes = 0;
+
+	ArenaBacking m_backing;
+	size_t m_pageSize = 0;
+	std::vector<uint64_t> m_committedBits;			//virtual backing only, bit set = page committed
+	size_t m_committedPages = 0;
+	size_t m_peakCommittedPages = 0;
+
+	static constexpr size_t DecommitThreshold = 64 * 1024;	//merged free blocks at least this big are decommitted
+	static constexpr size_t RetainedFreeBytes = 1024 * 1024;	//committed but free memory kept so alloc/free cycles do not commit every time
+
+	uint32_t GetLevelForSize(size_t size) const;
+	size_t GetBlockSizeForLevel(uint32_t level) const { return m_minBlockSize << level; }
+	uint64_t BlockIndex(uint64_t offset, uint32_t level) const { return offset >> (m_minBlockShift + level); }
 
-	std::vector<std::vector<void*>> m_freeblocks;
-	std::vector<int> m_blocklevel;
+	void* TakeBlock(uint32_t freeLevel, FreeBlock* block, uint32_t level, size_t size);
+	void PushFree(uint32_t level, uint64_t offset);
+	void RemoveFree(uint32_t level, FreeBlock* block, uint64_t offset);
+	bool IsFree(uint32_t level, uint64_t offset) const;
+	bool IsAllocated(uint32_t level, uint64_t offset) const;
+	void SetAllocated(uint32_t level, uint64_t offset, bool allocated);
+	bool FindLowestFree(uint32_t level, uint64_t endOffset, uint64_t& outOffset) const;
 
-	int GetLevelForSize(size_t size);
-	size_t GetBlockSizeForLevel(size_t level);
-	void Split(int level);
-	void Merge(int level, int offset);
+	bool CommitRange(uint64_t offset, size_t size);
+	void DecommitRange(uint64_t offset, size_t size);
 };
@@ -0,0 +1,249 @@
+#include "ConcurrentPoolAllocator.hpp"
+#include "MemoryTrace.hpp"
+#include <cstdlib>
+#include <mutex>
+#include <new>
+#include <vector>
+
+namespace
+{
+    constexpr uint32_t NoSlot = UINT32_MAX;
+
+    // Hands out small dense thread ids so every allocator can index its magazines directly.
+    // Ids are recycled when a thread exits, the magazine contents simply carry over to the next owner.
+    class ThreadSlotRegistry
+    {
+    public:
+        uint32_t Acquire()
+        {
+            std::scoped_lock lock(m_mutex);
+            if (!m_freeSlots.empty())
+            {
+                uint32_t slot = m_freeSlots.back();
+                m_freeSlots.pop_back();
+                return slot;
+            }
+            if (m_nextSlot >= ConcurrentPoolAllocator::MaxThreads)
+                return NoSlot;
+            return m_nextSlot++;
+        }
+
+        void Release(uint32_t slot)
+        {
+            if (slot == NoSlot) return;
+            std::scoped_lock lock(m_mutex);
+            m_freeSlots.push_back(slot);
+        }
+
+    private:
+        std::mutex m_mutex;
+        std::vector<uint32_t> m_freeSlots;
+        uint32_t m_nextSlot = 0;
+    };
+
+    ThreadSlotRegistry& GetSlotRegistry()
+    {
+        static ThreadSlotRegistry registry;
+        return registry;
+    }
+
+    struct ThreadSlot
+    {
+        uint32_t index;
+        ThreadSlot() : index(GetSlotRegistry().Acquire()) {}
+        ~ThreadSlot() { GetSlotRegistry().Release(index); }
+    };
+
+    uint32_t CurrentThreadSlot()
+    {
+        thread_local ThreadSlot slot;
+        return slot.index;
+    }
+}
+
+ConcurrentPoolAllocator::ConcurrentPoolAllocator(size_t objectSize, size_t objectCount, size_t alignment)
+    : m_objectSize(objectSize),
+    m_objectCount(objectCount),
+    m_alignment(alignment),
+    m_rawMemory(nullptr),
+    m_memoryBlock(nullptr),
+    m_centralHead(0),
+    m_magazines(nullptr)
+{
+    if (objectCount == 0 || objectCount >= UINT32_MAX) {
+        throw std::bad_alloc();
+    }
+
+    m_objectSize = (objectSize + (alignment - 1)) & ~(alignment - 1);
+
+    if (m_objectSize < sizeof(void*)) {
+        m_objectSize = sizeof(void*);
+    }
+
+    size_t totalSize = m_objectSize * objectCount;
+
+    m_rawMemory = std::malloc(totalSize + alignment);
+    if (!m_rawMemory) {
+        throw std::bad_alloc();
+    }
+
+    std::uintptr_t rawAddr = reinterpret_cast<std::uintptr_t>(m_rawMemory);
+    std::uintptr_t alignedAddr = (rawAddr + (alignment - 1)) & ~(alignment - 1);
+    m_memoryBlock = reinterpret_cast<char*>(alignedAddr);
+
+    //Link every block into the central list, index 0 first
+    for (size_t i = 0; i < objectCount; ++i)
+    {
+        uint32_t next = (i + 1 < objectCount) ? static_cast<uint32_t>(i + 2) : 0;
+        new (m_memoryBlock + i * m_objectSize) std::atomic<uint32_t>(next);
+    }
+    m_centralHead.store(1, std::memory_order_release);
+
+    m_magazines = new Magazine[MaxThreads];
+}
+
+ConcurrentPoolAllocator::~ConcurrentPoolAllocator()
+{
+    delete[] m_magazines;
+    std::free(m_rawMemory);
+}
+
+void* ConcurrentPoolAllocator::Allocate()
+{
+    uint32_t slot = CurrentThreadSlot();
+    if (slot == NoSlot)
+    {
+        void* block = PopCentral();
+        if (block)
+        {
+            MEM_TRACK_ALLOC(MemoryTag::Pool, m_objectSize);
+            MEM_TRACE_ALLOC(MemoryTag::Pool, this, block, m_objectSize, m_alignment);
+        }
+        return block;
+    }
+
+    Magazine& mag = m_magazines[slot];
+    if (mag.count == 0)
+    {
+        //Refill half a magazine so the next frees do not immediately drain again
+        while (mag.count < TransferBatch)
+        {
+            void* block = PopCentral();
+            if (!block) break;
+            mag.blocks[mag.count++] = block;
+        }
+
+        if (mag.count == 0)
+            return nullptr;
+    }
+
+    void* block = mag.blocks[--mag.count];
+    MEM_TRACK_ALLOC(MemoryTag::Pool, m_objectSize);
+    MEM_TRACE_ALLOC(MemoryTag::Pool, this, block, m_objectSize, m_alignment);
+    return block;
+}
+
+void ConcurrentPoolAllocator::Free(void* ptr)
+{
+    if (!ptr)
+        return;
+
+    MEM_TRACK_FREE(MemoryTag::Pool, m_objectSize);
+    MEM_TRACE_FREE(MemoryTag::Pool, this, ptr);
+    uint32_t slot = CurrentThreadSlot();
+    if (slot == NoSlot)
+    {
+        NextOf(ptr).store(0, std::memory_order_relaxed);
+        PushCentral(ptr, ptr);
+        return;
+    }
+
+    Magazine& mag = m_magazines[slot];
+    if (mag.count == MagazineSize)
+    {
+        //Drain the oldest half as one chain, a single CAS publishes it
+        void* first = mag.blocks[0];
+        for (size_t i = 0; i + 1 < TransferBatch; ++i)
+            NextOf(mag.blocks[i]).store(IndexOf(mag.blocks[i + 1]) + 1, std::memory_order_relaxed);
+        void* last = mag.blocks[TransferBatch - 1];
+        PushCentral(first, last);
+
+        for (size_t i = TransferBatch; i < MagazineSize; ++i)
+            mag.blocks[i - TransferBatch] = mag.blocks[i];
+        mag.count -= TransferBatch;
+    }
+
+    mag.blocks[mag.count++] = ptr;
+}
+
+void ConcurrentPoolAllocator::FlushThreadCache()
+{
+    uint32_t slot = CurrentThreadSlot();
+    if (slot == NoSlot)
+        return;
+
+    Magazine& mag = m_magazines[slot];
+    if (mag.count == 0)
+        return;
+
+    for (size_t i = 0; i + 1 < mag.count; ++i)
+        NextOf(mag.blocks[i]).store(IndexOf(mag.blocks[i + 1]) + 1, std::memory_order_relaxed);
+    PushCentral(mag.blocks[0], mag.blocks[mag.count - 1]);
+    mag.count = 0;
+}
+
+void* ConcurrentPoolAllocator::PopCentral()
+{
+    uint64_t head = m_centralHead.load(std::memory_order_acquire);
+    while (true)
+    {
+        uint32_t first = static_cast<uint32_t>(head);
+        if (first == 0)
+            return nullptr;
+
+        void* block = BlockAt(first - 1);
+        //The block may already be taken by another thread, the tag makes the CAS fail in that case
+        uint32_t next = NextOf(block).load(std::memory_order_relaxed);
+        uint64_t tag = (head >> 32) + 1;
+        uint64_t newHead = (tag << 32) | next;
+
+        if (m_centralHead.compare_exchange_weak(head, newHead,
+            std::memory_order_acq_rel, std::memory_order_acquire))
+        {
+            return block;
+        }
+    }
+}
+
+void ConcurrentPoolAllocator::PushCentral(void* first, void* last)
+{
+    uint32_t firstIndex = IndexOf(first) + 1;
+    uint64_t head = m_centralHead.load(std::memory_order_relaxed);
+    while (true)
+    {
+        NextOf(last).store(static_cast<uint32_t>(head), std::memory_order_relaxed);
+        uint64_t tag = (head >> 32) + 1;
+        uint64_t newHead = (tag << 32) | firstIndex;
+
+        if (m_centralHead.compare_exchange_weak(head, newHead,
+            std::memory_order_release, std::memory_order_relaxed))
+        {
+            return;
+        }
+    }
+}
+
+uint32_t ConcurrentPoolAllocator::IndexOf(void* block) const
+{
+    return static_cast<uint32_t>((static_cast<char*>(block) - m_memoryBlock) / m_objectSize);
+}
+
+void* ConcurrentPoolAllocator::BlockAt(uint32_t index) const
+{
+    return m_memoryBlock + static_cast<size_t>(index) * m_objectSize;
+}
+
+std::atomic<uint32_t>& ConcurrentPoolAllocator::NextOf(void* block)
+{
+    return *reinterpret_cast<std::atomic<uint32_t>*>(block);
+}
@@ -0,0 +1,60 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include "MemoryTracking.hpp"
+
+/*
+* Thread-safe fixed size pool.
+* Every thread owns a small magazine of free blocks and only touches the shared
+* lock-free list when its magazine runs empty (refill) or full (drain).
+*/
+class ConcurrentPoolAllocator
+{
+public:
+    static constexpr size_t MaxThreads = 64;      // threads above this go straight to the central list
+    static constexpr size_t MagazineSize = 32;    // blocks cached per thread
+    static constexpr size_t TransferBatch = MagazineSize / 2;
+
+    ConcurrentPoolAllocator(size_t objectSize, size_t objectCount, size_t alignment);
+    ~ConcurrentPoolAllocator();
+
+    ConcurrentPoolAllocator(const ConcurrentPoolAllocator&) = delete;
+    ConcurrentPoolAllocator& operator=(const ConcurrentPoolAllocator&) = delete;
+
+    void* Allocate();
+    void Free(void* ptr);
+
+    // Give the calling thread's cached blocks back to the central list (call before a worker exits)
+    void FlushThreadCache();
+
+    size_t GetObjectSize() const { return m_objectSize; }
+    size_t GetObjectCount() const { return m_objectCount; }
+    size_t GetAlignment() const { return m_alignment; }
+
+private:
+    struct alignas(64) Magazine
+    {
+        size_t count = 0;
+        void* blocks[MagazineSize];
+    };
+
+    void* PopCentral();
+    void PushCentral(void* first, void* last);
+
+    uint32_t IndexOf(void* block) const;
+    void* BlockAt(uint32_t index) const;
+
+    static std::atomic<uint32_t>& NextOf(void* block);
+
+    size_t m_objectSize;
+    size_t m_objectCount;
+    size_t m_alignment;
+    void* m_rawMemory;
+    char* m_memoryBlock;
+
+    // Low 32 bits: index + 1 of the first free block (0 = empty), high 32 bits: ABA tag
+    alignas(64) std::atomic<uint64_t> m_centralHead;
+
+    Magazine* m_magazines;
+};
@@ -0,0 +1,71 @@
+#include "FrameAllocator.hpp"
+
+FrameAllocator::FrameAllocator(size_t bufferCount, size_t capacityPerBuffer,
+    ArenaBacking backing, StackOverflowMode overflowMode)
+{
+    if (bufferCount == 0)
+        bufferCount = 1;
+
+    m_buffers.reserve(bufferCount);
+    for (size_t i = 0; i < bufferCount; ++i)
+        m_buffers.push_back(std::make_unique<StackAllocator>(capacityPerBuffer, backing, overflowMode));
+}
+
+uint64_t FrameAllocator::BeginFrame()
+{
+    uint64_t frame = m_currentFrame + 1;
+    uint64_t bufferCount = m_buffers.size();
+
+    //The buffer was last used by frame - N, wait until the consumer let go of it
+    if (frame > bufferCount)
+    {
+        std::unique_lock lock(m_fenceMutex);
+        m_fenceChanged.wait(lock, [&]() { return m_consumedFence >= frame - bufferCount; });
+    }
+
+    m_currentFrame = frame;
+    Current().Reset();
+    return frame;
+}
+
+void FrameAllocator::EndFrame()
+{
+    {
+        std::scoped_lock lock(m_fenceMutex);
+        m_producedFence = m_currentFrame;
+    }
+    m_fenceChanged.notify_all();
+}
+
+void* FrameAllocator::Allocate(size_t size, size_t alignment)
+{
+    return Current().Allocate(size, alignment);
+}
+
+void FrameAllocator::WaitForFrame(uint64_t frame)
+{
+    std::unique_lock lock(m_fenceMutex);
+    m_fenceChanged.wait(lock, [&]() { return m_producedFence >= frame; });
+}
+
+void FrameAllocator::ReleaseFrame(uint64_t frame)
+{
+    {
+        std::scoped_lock lock(m_fenceMutex);
+        if (frame > m_consumedFence)
+            m_consumedFence = frame;
+    }
+    m_fenceChanged.notify_all();
+}
+
+uint64_t FrameAllocator::GetProducedFrame() const
+{
+    std::scoped_lock lock(m_fenceMutex);
+    return m_producedFence;
+}
+
+uint64_t FrameAllocator::GetConsumedFrame() const
+{
+    std::scoped_lock lock(m_fenceMutex);
+    return m_consumedFence;
+}
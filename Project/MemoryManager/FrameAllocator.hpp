@@ -0,0 +1,54 @@
+#pragma once
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include "StackAllocator.hpp"
+
+/*
+* N-buffered frame allocator.
+* Frame k allocates from buffer k % N. The buffer is only reset when frame k - N has been
+* released by the consumer, so data built during a frame stays valid while the next frames
+* are simulated. Frames are numbered from 1.
+*
+* Producer: BeginFrame -> Allocate... -> EndFrame
+* Consumer: WaitForFrame(k) -> read -> ReleaseFrame(k)
+*/
+class FrameAllocator
+{
+public:
+    FrameAllocator(size_t bufferCount, size_t capacityPerBuffer,
+        ArenaBacking backing = ArenaBacking::Heap, StackOverflowMode overflowMode = StackOverflowMode::ChainBlocks);
+
+    FrameAllocator(const FrameAllocator&) = delete;
+    FrameAllocator& operator=(const FrameAllocator&) = delete;
+
+    // Blocks until the buffer of the new frame has been consumed, then resets it
+    uint64_t BeginFrame();
+    // Publishes the current frame to the consumer
+    void EndFrame();
+
+    void* Allocate(size_t size, size_t alignment = alignof(::max_align_t));
+    StackAllocator& Current() { return *m_buffers[m_currentFrame % m_buffers.size()]; }
+    const StackAllocator& Current() const { return *m_buffers[m_currentFrame % m_buffers.size()]; }
+    uint64_t GetCurrentFrame() const { return m_currentFrame; }
+
+    // Blocks until the producer ended the frame
+    void WaitForFrame(uint64_t frame);
+    // The consumer is done with the frame (and every frame before it)
+    void ReleaseFrame(uint64_t frame);
+
+    uint64_t GetProducedFrame() const;
+    uint64_t GetConsumedFrame() const;
+    size_t GetBufferCount() const { return m_buffers.size(); }
+
+private:
+    std::vector<std::unique_ptr<StackAllocator>> m_buffers;
+    uint64_t m_currentFrame = 0;    // producer only
+
+    mutable std::mutex m_fenceMutex;
+    std::condition_variable m_fenceChanged;
+    uint64_t m_producedFence = 0;   // last frame ended by the producer
+    uint64_t m_consumedFence = 0;   // last frame released by the consumer
+};
@@ -0,0 +1,405 @@
+#include "GuardedAllocator.hpp"
+#include "VirtualMemory.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <new>
+#ifdef _WIN32
+#include <Windows.h>
+#elif defined(__linux__)
+#include <signal.h>
+#include <unistd.h>
+#endif
+
+thread_local uint32_t GuardedAllocator::t_countdown = 0;
+
+namespace
+{
+    // Only one allocator reports faults, the one that installed the handler
+    std::atomic<GuardedAllocator*> g_faultAllocator{ nullptr };
+
+#ifdef _WIN32
+    PVOID g_vectoredHandler = nullptr;
+#elif defined(__linux__)
+    struct sigaction g_previousSegv;
+    struct sigaction g_previousBus;
+#endif
+
+    thread_local uint64_t t_random = 0;
+
+    uint64_t NextRandom()
+    {
+        //xorshift64, seeded from the thread-local address so threads do not sample in lockstep
+        if (t_random == 0)
+            t_random = reinterpret_cast<uintptr_t>(&t_random) | 1;
+        t_random ^= t_random << 13;
+        t_random ^= t_random >> 7;
+        t_random ^= t_random << 17;
+        return t_random;
+    }
+
+    // Fault reports are written from the signal handler, so no stdio and no allocation:
+    // the line is formatted into a fixed buffer and written with one system call
+    class FaultMessage
+    {
+    public:
+        FaultMessage& operator<<(const char* text)
+        {
+            while (*text && m_length < sizeof(m_buffer) - 1)
+                m_buffer[m_length++] = *text++;
+            return *this;
+        }
+
+        FaultMessage& operator<<(size_t value)
+        {
+            char digits[20];
+            size_t count = 0;
+            do
+            {
+                digits[count++] = static_cast<char>('0' + value % 10);
+                value /= 10;
+            } while (value != 0);
+            while (count > 0 && m_length < sizeof(m_buffer) - 1)
+                m_buffer[m_length++] = digits[--count];
+            return *this;
+        }
+
+        FaultMessage& operator<<(ptrdiff_t value)
+        {
+            if (value < 0)
+            {
+                *this << "-";
+                return *this << static_cast<size_t>(0 - static_cast<size_t>(value));
+            }
+            return *this << static_cast<size_t>(value);
+        }
+
+        FaultMessage& operator<<(const void* pointer)
+        {
+            uintptr_t value = reinterpret_cast<uintptr_t>(pointer);
+            *this << "0x";
+            for (int shift = sizeof(uintptr_t) * 8 - 4; shift >= 0; shift -= 4)
+            {
+                if (m_length < sizeof(m_buffer) - 1)
+                    m_buffer[m_length++] = "0123456789abcdef"[(value >> shift) & 0xF];
+            }
+            return *this;
+        }
+
+        void Write()
+        {
+            m_buffer[m_length++] = '\n';
+#ifdef _WIN32
+            DWORD written = 0;
+            WriteFile(GetStdHandle(STD_ERROR_HANDLE), m_buffer, static_cast<DWORD>(m_length), &written, nullptr);
+#elif defined(__linux__)
+            ssize_t result = write(STDERR_FILENO, m_buffer, m_length);
+            (void)result;
+#endif
+        }
+
+    private:
+        char m_buffer[256];
+        size_t m_length = 0;
+    };
+}
+
+GuardedAllocator::GuardedAllocator(const GuardedAllocatorConfig& config)
+    : m_pageSize(VirtualMemory::GetPageSize()),
+    m_sampleRate(config.sampleRate)
+{
+    size_t maxSize = config.maxAllocationSize ? config.maxAllocationSize : m_pageSize;
+    m_slotSize = (maxSize + m_pageSize - 1) / m_pageSize * m_pageSize;
+    m_maxAllocationSize = m_slotSize;
+    m_slotStride = m_slotSize + m_pageSize;
+
+    size_t slotCount = config.slotCount ? config.slotCount : 1;
+    //Leading guard, then every slot followed by its guard
+    m_regionSize = m_pageSize + slotCount * m_slotStride;
+
+    m_base = static_cast<char*>(VirtualMemory::Reserve(m_regionSize));
+    if (!m_base)
+        throw std::bad_alloc();
+
+    //Everything starts committed and no-access, allocating only flips protection
+    if (!VirtualMemory::Commit(m_base, m_regionSize) || !VirtualMemory::Protect(m_base, m_regionSize, false))
+    {
+        VirtualMemory::Release(m_base, m_regionSize);
+        throw std::bad_alloc();
+    }
+
+    m_slots.resize(slotCount);
+    m_freeQueue.resize(slotCount);
+    for (size_t i = 0; i < slotCount; ++i)
+        m_freeQueue[i] = static_cast<uint32_t>(i);
+    m_queueCount = slotCount;
+
+    if (config.installFaultHandler)
+        InstallFaultHandler(this);
+}
+
+GuardedAllocator::~GuardedAllocator()
+{
+    RemoveFaultHandler(this);
+    VirtualMemory::Release(m_base, m_regionSize);
+}
+
+uint32_t GuardedAllocator::NextInterval() const
+{
+    //Uniform in [1, 2 * rate] so the average gap is the sample rate but the pattern is not predictable
+    return static_cast<uint32_t>(NextRandom() % (uint64_t(m_sampleRate) * 2)) + 1;
+}
+
+void* GuardedAllocator::Allocate(size_t size, size_t alignment, MemoryTag tag)
+{
+    if (size > m_slotSize)
+        return nullptr;
+    if (size == 0)
+        size = 1;
+    if (alignment == 0)
+        alignment = 1;
+
+    std::scoped_lock lock(m_mutex);
+    if (m_queueCount == 0)
+    {
+        m_slotsExhausted.fetch_add(1, std::memory_order_relaxed);
+        return nullptr;
+    }
+
+    uint32_t index = m_freeQueue[m_queueHead];
+    char* start = SlotStart(index);
+    if (!VirtualMemory::Protect(start, m_slotSize, true))
+    {
+        std::cout << "[Guarded] ERROR: could not unprotect slot " << index << "\n";
+        return nullptr;
+    }
+    m_queueHead = (m_queueHead + 1) % m_freeQueue.size();
+    --m_queueCount;
+
+    Slot& slot = m_slots[index];
+    slot.size = size;
+    slot.tag = tag;
+    slot.state = SlotState::Live;
+    slot.rightAligned = m_nextRightAligned;
+    m_nextRightAligned = !m_nextRightAligned;
+
+    if (slot.rightAligned)
+    {
+        //End as close to the guard after the slot as the alignment allows
+        uintptr_t end = reinterpret_cast<uintptr_t>(start) + m_slotSize;
+        slot.userPtr = reinterpret_cast<char*>((end - size) & ~(uintptr_t(alignment) - 1));
+    }
+    else
+    {
+        slot.userPtr = start;
+    }
+
+    m_sampledAllocations.fetch_add(1, std::memory_order_relaxed);
+    MEM_TRACK_ALLOC(tag, size);
+    return slot.userPtr;
+}
+
+void GuardedAllocator::Free(void* ptr)
+{
+    size_t index;
+    if (!SlotIndexOf(ptr, index))
+    {
+        std::cout << "[Guarded] ERROR: free of " << ptr << " which is not a guarded allocation\n";
+        return;
+    }
+
+    std::scoped_lock lock(m_mutex);
+    Slot& slot = m_slots[index];
+    if (slot.state != SlotState::Live)
+    {
+        std::cout << "[Guarded] ERROR: double free of " << ptr << " (slot " << index << ")\n";
+        return;
+    }
+    if (slot.userPtr != ptr)
+    {
+        std::cout << "[Guarded] ERROR: free of " << ptr << " which points into slot " << index
+            << " but the allocation starts at " << static_cast<void*>(slot.userPtr) << "\n";
+        return;
+    }
+
+    MEM_TRACK_FREE(slot.tag, slot.size);
+    VirtualMemory::Protect(SlotStart(index), m_slotSize, false);
+    slot.state = SlotState::Quarantined;
+
+    size_t tail = (m_queueHead + m_queueCount) % m_freeQueue.size();
+    m_freeQueue[tail] = static_cast<uint32_t>(index);
+    ++m_queueCount;
+}
+
+size_t GuardedAllocator::GetAllocationSize(const void* ptr) const
+{
+    size_t index;
+    if (!SlotIndexOf(ptr, index))
+        return 0;
+
+    std::scoped_lock lock(m_mutex);
+    return m_slots[index].state == SlotState::Live ? m_slots[index].size : 0;
+}
+
+void GuardedAllocator::GetStats(GuardedAllocatorStats& outStats) const
+{
+    std::scoped_lock lock(m_mutex);
+    outStats.sampledAllocations = m_sampledAllocations.load(std::memory_order_relaxed);
+    outStats.slotsExhausted = m_slotsExhausted.load(std::memory_order_relaxed);
+    outStats.liveSlots = m_slots.size() - m_queueCount;
+}
+
+bool GuardedAllocator::SlotIndexOf(const void* ptr, size_t& outIndex) const
+{
+    if (!Owns(ptr))
+        return false;
+
+    size_t offset = static_cast<size_t>(static_cast<const char*>(ptr) - m_base);
+    if (offset < m_pageSize)
+        return false;
+
+    offset -= m_pageSize;
+    if (offset % m_slotStride >= m_slotSize)
+        return false;   // guard page
+
+    outIndex = offset / m_slotStride;
+    return true;
+}
+
+bool GuardedAllocator::ReportFault(const void* address) const
+{
+    if (!Owns(address))
+        return false;
+
+    //No locking and no stdio, this runs in the fault handler and the mutex may be held by the faulting thread
+    const char* p = static_cast<const char*>(address);
+    size_t offset = static_cast<size_t>(p - m_base);
+    size_t index;
+
+    if (SlotIndexOf(address, index))
+    {
+        const Slot& slot = m_slots[index];
+        if (slot.state == SlotState::Live)
+        {
+            (FaultMessage() << "[Guarded] " << (p < slot.userPtr ? "buffer underflow" : "buffer overflow") << " of "
+                << slot.size << " byte " << GetMemoryTagName(slot.tag) << " allocation at " << static_cast<const void*>(slot.userPtr)
+                << " (slot " << index << ", " << ptrdiff_t(p - slot.userPtr) << " bytes from start)").Write();
+        }
+        else
+        {
+            (FaultMessage() << "[Guarded] use-after-free of " << slot.size << " byte " << GetMemoryTagName(slot.tag)
+                << " allocation at " << static_cast<const void*>(slot.userPtr) << " (slot " << index << ", "
+                << ptrdiff_t(p - slot.userPtr) << " bytes from start)").Write();
+        }
+        return true;
+    }
+
+    //Guard page, blame the live neighbour whose edge touches it
+    size_t guardIndex = offset < m_pageSize ? SIZE_MAX : (offset - m_pageSize) / m_slotStride;
+    const Slot* before = guardIndex != SIZE_MAX ? &m_slots[guardIndex] : nullptr;
+    const Slot* after = guardIndex + 1 < m_slots.size() ? &m_slots[guardIndex + 1] : nullptr;
+
+    if (before && before->state == SlotState::Live && before->rightAligned)
+    {
+        (FaultMessage() << "[Guarded] buffer overflow of " << before->size << " byte " << GetMemoryTagName(before->tag)
+            << " allocation at " << static_cast<const void*>(before->userPtr) << " (slot " << guardIndex << ", "
+            << ptrdiff_t(p - (before->userPtr + before->size)) << " bytes past the end)").Write();
+    }
+    else if (after && after->state == SlotState::Live && !after->rightAligned)
+    {
+        (FaultMessage() << "[Guarded] buffer underflow of " << after->size << " byte " << GetMemoryTagName(after->tag)
+            << " allocation at " << static_cast<const void*>(after->userPtr) << " (slot " << size_t(guardIndex + 1) << ", "
+            << ptrdiff_t(after->userPtr - p) << " bytes before the start)").Write();
+    }
+    else
+    {
+        (FaultMessage() << "[Guarded] wild access to guard page at " << address).Write();
+    }
+    return true;
+}
+
+#ifdef _WIN32
+
+static LONG CALLBACK GuardedFaultHandler(EXCEPTION_POINTERS* info)
+{
+    GuardedAllocator* allocator = g_faultAllocator.load();
+    if (allocator && info->ExceptionRecord->ExceptionCode == EXCEPTION_ACCESS_VIOLATION &&
+        info->ExceptionRecord->NumberParameters >= 2)
+    {
+        const void* address = reinterpret_cast<const void*>(info->ExceptionRecord->ExceptionInformation[1]);
+        allocator->ReportFault(address);
+    }
+    //Report only, the debugger or crash handler still gets the exception
+    return EXCEPTION_CONTINUE_SEARCH;
+}
+
+void GuardedAllocator::InstallFaultHandler(GuardedAllocator* allocator)
+{
+    GuardedAllocator* expected = nullptr;
+    if (!g_faultAllocator.compare_exchange_strong(expected, allocator))
+        return;
+
+    g_vectoredHandler = AddVectoredExceptionHandler(1, GuardedFaultHandler);
+    allocator->m_faultHandler = true;
+}
+
+void GuardedAllocator::RemoveFaultHandler(GuardedAllocator* allocator)
+{
+    if (!allocator->m_faultHandler)
+        return;
+
+    RemoveVectoredExceptionHandler(g_vectoredHandler);
+    g_vectoredHandler = nullptr;
+    g_faultAllocator.store(nullptr);
+    allocator->m_faultHandler = false;
+}
+
+#elif defined(__linux__)
+
+static void GuardedFaultHandler(int signal, siginfo_t* info, void*)
+{
+    GuardedAllocator* allocator = g_faultAllocator.load();
+    if (allocator)
+        allocator->ReportFault(info->si_addr);
+
+    //Put the previous handler back and return, the access faults again and takes the normal crash path
+    sigaction(signal, signal == SIGBUS ? &g_previousBus : &g_previousSegv, nullptr);
+}
+
+void GuardedAllocator::InstallFaultHandler(GuardedAllocator* allocator)
+{
+    GuardedAllocator* expected = nullptr;
+    if (!g_faultAllocator.compare_exchange_strong(expected, allocator))
+        return;
+
+    struct sigaction action {};
+    action.sa_sigaction = GuardedFaultHandler;
+    action.sa_flags = SA_SIGINFO;
+    sigemptyset(&action.sa_mask);
+    sigaction(SIGSEGV, &action, &g_previousSegv);
+    sigaction(SIGBUS, &action, &g_previousBus);
+    allocator->m_faultHandler = true;
+}
+
+void GuardedAllocator::RemoveFaultHandler(GuardedAllocator* allocator)
+{
+    if (!allocator->m_faultHandler)
+        return;
+
+    sigaction(SIGSEGV, &g_previousSegv, nullptr);
+    sigaction(SIGBUS, &g_previousBus, nullptr);
+    g_faultAllocator.store(nullptr);
+    allocator->m_faultHandler = false;
+}
+
+#else
+
+void GuardedAllocator::InstallFaultHandler(GuardedAllocator*)
+{
+}
+
+void GuardedAllocator::RemoveFaultHandler(GuardedAllocator*)
+{
+}
+
+#endif
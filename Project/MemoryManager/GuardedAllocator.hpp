@@ -0,0 +1,119 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+#include "MemoryTracking.hpp"
+
+struct GuardedAllocatorConfig
+{
+    size_t slotCount = 256;         // live + quarantined sampled allocations
+    uint32_t sampleRate = 5000;     // on average 1 in sampleRate allocations is guarded, 0 = never
+    size_t maxAllocationSize = 0;   // bigger requests are never sampled, 0 = one page
+    bool installFaultHandler = true;
+};
+
+struct GuardedAllocatorStats
+{
+    size_t sampledAllocations = 0;
+    size_t slotsExhausted = 0;      // sampled but every slot was live
+    size_t liveSlots = 0;
+};
+
+/*
+* Sampling guarded allocator (GWP-ASan style).
+* A small fixed set of slots is reserved up front, every slot sits between two no-access guard pages.
+* Sampled allocations are placed against one of the guards (alternating) so both overflow and
+* underflow fault on the first bad byte. Freed slots go back no-access and to the end of the free
+* queue, so a use-after-free faults for as long as the slot stays quarantined.
+* The unsampled path costs one thread-local decrement, ownership checks are a range compare.
+*/
+class GuardedAllocator
+{
+public:
+    explicit GuardedAllocator(const GuardedAllocatorConfig& config = {});
+    ~GuardedAllocator();
+
+    GuardedAllocator(const GuardedAllocator&) = delete;
+    GuardedAllocator& operator=(const GuardedAllocator&) = delete;
+
+    // True roughly once every sampleRate calls on the calling thread
+    bool ShouldSample(size_t size) const
+    {
+        if (size > m_maxAllocationSize || m_sampleRate == 0)
+            return false;
+
+        if (t_countdown > 1)
+        {
+            --t_countdown;
+            return false;
+        }
+        //A zero countdown means the thread has not been seeded yet, that call is never sampled
+        bool seeded = t_countdown != 0;
+        t_countdown = NextInterval();
+        return seeded;
+    }
+
+    // nullptr when every slot is in use, the caller falls back to its normal allocator
+    void* Allocate(size_t size, size_t alignment, MemoryTag tag);
+    void Free(void* ptr);
+
+    bool Owns(const void* ptr) const
+    {
+        const char* p = static_cast<const char*>(ptr);
+        return p >= m_base && p < m_base + m_regionSize;
+    }
+
+    size_t GetAllocationSize(const void* ptr) const;
+    void GetStats(GuardedAllocatorStats& outStats) const;
+
+    // Prints what kind of bug hit the address, false if the address is not ours. Called from the fault handler
+    bool ReportFault(const void* address) const;
+
+private:
+    enum class SlotState : uint8_t
+    {
+        Free,
+        Live,
+        Quarantined
+    };
+
+    struct Slot
+    {
+        char* userPtr = nullptr;
+        size_t size = 0;
+        MemoryTag tag = MemoryTag::Pool;
+        SlotState state = SlotState::Free;
+        bool rightAligned = false;
+    };
+
+    uint32_t NextInterval() const;
+
+    char* SlotStart(size_t index) const { return m_base + m_pageSize + index * m_slotStride; }
+    bool SlotIndexOf(const void* ptr, size_t& outIndex) const;
+
+    static void InstallFaultHandler(GuardedAllocator* allocator);
+    static void RemoveFaultHandler(GuardedAllocator* allocator);
+
+    size_t m_pageSize;
+    size_t m_slotSize;          // whole pages
+    size_t m_slotStride;        // slot + the guard page after it
+    size_t m_regionSize;
+    size_t m_maxAllocationSize;
+    uint32_t m_sampleRate;
+    char* m_base = nullptr;
+    bool m_faultHandler = false;
+
+    mutable std::mutex m_mutex;
+    std::vector<Slot> m_slots;
+    std::vector<uint32_t> m_freeQueue;  // ring buffer, freed slots go to the back
+    size_t m_queueHead = 0;
+    size_t m_queueCount = 0;
+    bool m_nextRightAligned = true;
+
+    std::atomic<size_t> m_sampledAllocations{ 0 };
+    std::atomic<size_t> m_slotsExhausted{ 0 };
+
+    static thread_local uint32_t t_countdown;
+};
@@ -0,0 +1,171 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <memory_resource>
+#include <utility>
+#include <vector>
+
+// 32-bit handle, low IndexBits select the slot and the rest is the slot generation. 0 is the null handle
+template<typename T>
+struct Handle
+{
+    static constexpr uint32_t IndexBits = 20;
+    static constexpr uint32_t IndexMask = (1u << IndexBits) - 1;
+    static constexpr uint32_t GenerationMask = (1u << (32 - IndexBits)) - 1;
+
+    uint32_t value = 0;
+
+    uint32_t GetIndex() const { return value & IndexMask; }
+    uint32_t GetGeneration() const { return value >> IndexBits; }
+
+    explicit operator bool() const { return value != 0; }
+    bool operator==(const Handle& other) const { return value == other.value; }
+    bool operator!=(const Handle& other) const { return value != other.value; }
+
+    static Handle Make(uint32_t index, uint32_t generation) { return Handle{ (generation << IndexBits) | index }; }
+};
+
+/*
+* Generational object pool.
+* Objects live packed in one array so Update/Render loops walk contiguous memory,
+* handles go through a sparse slot table that points into the packed array.
+* Destroy moves the last object into the hole (O(1)) and bumps the slot generation,
+* so every handle to the destroyed object stops resolving. Freed slots are reused
+* oldest first, which keeps the 12-bit generation from wrapping quickly on any one slot.
+* Pointers and references into the pool are invalidated by Create and Destroy, keep handles instead.
+*/
+template<typename T>
+class HandlePool
+{
+public:
+    using HandleType = Handle<T>;
+    static constexpr uint32_t MaxObjects = HandleType::IndexMask + 1;
+
+    explicit HandlePool(std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+        : m_objects(resource), m_denseToSlot(resource), m_slots(resource) {}
+
+    void Reserve(size_t count)
+    {
+        m_objects.reserve(count);
+        m_denseToSlot.reserve(count);
+        m_slots.reserve(count);
+    }
+
+    // Null handle when MaxObjects are alive
+    template<typename... Args>
+    HandleType Create(Args&&... args)
+    {
+        uint32_t slotIndex;
+        if (m_freeHead != InvalidSlot)
+        {
+            slotIndex = m_freeHead;
+            m_freeHead = m_slots[slotIndex].nextFree;
+            if (m_freeHead == InvalidSlot)
+                m_freeTail = InvalidSlot;
+        }
+        else
+        {
+            if (m_slots.size() >= MaxObjects)
+                return {};
+            slotIndex = static_cast<uint32_t>(m_slots.size());
+            m_slots.push_back(Slot{});
+        }
+
+        Slot& slot = m_slots[slotIndex];
+        slot.dense = static_cast<uint32_t>(m_objects.size());
+        slot.nextFree = InvalidSlot;
+
+        m_objects.emplace_back(std::forward<Args>(args)...);
+        m_denseToSlot.push_back(slotIndex);
+        return HandleType::Make(slotIndex, slot.generation);
+    }
+
+    // False for null or stale handles
+    bool Destroy(HandleType handle)
+    {
+        if (!IsValid(handle))
+            return false;
+
+        uint32_t slotIndex = handle.GetIndex();
+        uint32_t dense = m_slots[slotIndex].dense;
+        uint32_t last = static_cast<uint32_t>(m_objects.size() - 1);
+
+        //Swap and pop, the moved object's slot follows it
+        if (dense != last)
+        {
+            m_objects[dense] = std::move(m_objects[last]);
+            m_denseToSlot[dense] = m_denseToSlot[last];
+            m_slots[m_denseToSlot[dense]].dense = dense;
+        }
+        m_objects.pop_back();
+        m_denseToSlot.pop_back();
+
+        Slot& slot = m_slots[slotIndex];
+        slot.dense = InvalidSlot;
+        //Generation 0 is skipped so a live handle is never 0
+        slot.generation = (slot.generation + 1) & HandleType::GenerationMask;
+        if (slot.generation == 0)
+            slot.generation = 1;
+
+        if (m_freeTail != InvalidSlot)
+            m_slots[m_freeTail].nextFree = slotIndex;
+        else
+            m_freeHead = slotIndex;
+        m_freeTail = slotIndex;
+        return true;
+    }
+
+    bool IsValid(HandleType handle) const
+    {
+        uint32_t slotIndex = handle.GetIndex();
+        if (!handle || slotIndex >= m_slots.size())
+            return false;
+
+        const Slot& slot = m_slots[slotIndex];
+        return slot.generation == handle.GetGeneration() && slot.dense != InvalidSlot;
+    }
+
+    // nullptr for null or stale handles
+    T* Get(HandleType handle) { return IsValid(handle) ? &m_objects[m_slots[handle.GetIndex()].dense] : nullptr; }
+    const T* Get(HandleType handle) const { return IsValid(handle) ? &m_objects[m_slots[handle.GetIndex()].dense] : nullptr; }
+
+    // Handle of the object at a packed position, for destroying while iterating by index
+    HandleType GetHandleAt(size_t denseIndex) const
+    {
+        uint32_t slotIndex = m_denseToSlot[denseIndex];
+        return HandleType::Make(slotIndex, m_slots[slotIndex].generation);
+    }
+
+    void Clear()
+    {
+        for (size_t i = m_objects.size(); i > 0; --i)
+            Destroy(GetHandleAt(i - 1));
+    }
+
+    size_t Size() const { return m_objects.size(); }
+    bool Empty() const { return m_objects.empty(); }
+
+    T& operator[](size_t denseIndex) { return m_objects[denseIndex]; }
+    const T& operator[](size_t denseIndex) const { return m_objects[denseIndex]; }
+
+    T* begin() { return m_objects.data(); }
+    T* end() { return m_objects.data() + m_objects.size(); }
+    const T* begin() const { return m_objects.data(); }
+    const T* end() const { return m_objects.data() + m_objects.size(); }
+
+private:
+    static constexpr uint32_t InvalidSlot = UINT32_MAX;
+
+    struct Slot
+    {
+        uint32_t dense = InvalidSlot;       // position in m_objects, InvalidSlot while free
+        uint32_t generation = 1;
+        uint32_t nextFree = InvalidSlot;
+    };
+
+    std::pmr::vector<T> m_objects;
+    std::pmr::vector<uint32_t> m_denseToSlot;
+    std::pmr::vector<Slot> m_slots;
+    uint32_t m_freeHead = InvalidSlot;
+    uint32_t m_freeTail = InvalidSlot;
+};
@@ -1,62 +1,175 @@
 #include "Memory.hpp"
 #include "PoolAllocator.hpp"
+#include "ConcurrentPoolAllocator.hpp"
 #include "StackAllocator.hpp"
 #include "BuddyAllocator.hpp"
+#include "RelocatableHeap.hpp"
 #include "StompAllocator.hpp"
+#include "TlsfAllocator.hpp"
+#include "GuardedAllocator.hpp"
+#include "SmallObjectAllocator.hpp"
+#include "PolicyAllocator.hpp"
+#include "MemoryTracking.hpp"
 #include <iostream>
 
-static PoolAllocator* g_pool = nullptr;
-static StackAllocator* g_stack = nullptr;
-static BuddyAllocator* g_buddy = nullptr;
-static StompAllocator* g_stomp = nullptr;
+//Debug builds check bounds and count, release builds call straight through, see ConfiguredAllocator
+using GlobalPool = ConfiguredAllocator<PoolAllocator>;                 // single threaded, the thread-safe pool is g_concurrentPool
+using GlobalStack = ConfiguredAllocator<StackAllocator>;               // one frame on one thread
+using GlobalBuddy = ConfiguredAllocator<BuddyAllocator>;               // shares its backing with the relocatable heap, main thread only
+using GlobalTlsf = ConfiguredAllocator<TlsfAllocator, MutexLock>;      // resource payloads are allocated on the loader threads
+using GlobalStomp = ConfiguredAllocator<StompAllocator, MutexLock>;
 
-void InitPool(size_t poolObjectSize, size_t poolObjectCount, size_t poolAlignment)
+static GlobalPool* g_pool = nullptr;
+static ConcurrentPoolAllocator* g_concurrentPool = nullptr;
+static GlobalStack* g_stack = nullptr;
+static GlobalBuddy* g_buddy = nullptr;
+static RelocatableHeap* g_relocatable = nullptr;
+static GlobalStomp* g_stomp = nullptr;
+static GlobalTlsf* g_tlsf = nullptr;
+static GuardedAllocator* g_guarded = nullptr;
+
+void InitPool(size_t poolObjectSize, size_t poolObjectCount, size_t poolAlignment, bool threadSafe)
+{
+    if (threadSafe)
+        g_concurrentPool = new ConcurrentPoolAllocator(poolObjectSize, poolObjectCount, poolAlignment);
+    else
+        g_pool = new GlobalPool(poolObjectSize, poolObjectCount, poolAlignment);
+}
+
+void InitStack(size_t stackSize, ArenaBacking backing)
 {
-    g_pool = new PoolAllocator(poolObjectSize, poolObjectCount, poolAlignment);
+    g_stack = new GlobalStack(stackSize, backing);
 }
 
-void InitStack(size_t stackSize)
+void InitBuddy(size_t minBlockSize, size_t totalSize, ArenaBacking backing)
 {
-    g_stack = new StackAllocator(stackSize);
+    g_buddy = new GlobalBuddy(minBlockSize, totalSize, backing);
+    g_relocatable = new RelocatableHeap(g_buddy->GetBacking());
 }
 
-void InitBuddy(size_t minBlockSize, size_t totalSize)
+void InitTlsf(size_t totalSize, ArenaBacking backing)
 {
-    g_buddy = new BuddyAllocator(minBlockSize, totalSize);
+    g_tlsf = new GlobalTlsf(totalSize, backing);
 }
 
-void InitStomp()
+void InitStomp(StompMode mode)
 {
-    g_stomp = new StompAllocator();
+    g_stomp = new GlobalStomp(mode);
+}
+
+void InitGuardedSampling(uint32_t sampleRate, size_t slotCount)
+{
+    GuardedAllocatorConfig config;
+    config.sampleRate = sampleRate;
+    config.slotCount = slotCount;
+    g_guarded = new GuardedAllocator(config);
 }
 
 void ShutdownMemory()
 {
     delete g_pool;
+    delete g_concurrentPool;
     delete g_stack;
+    delete g_relocatable;
     delete g_buddy;
     delete g_stomp;
+    delete g_tlsf;
+    delete g_guarded;
     g_pool = nullptr;
+    g_concurrentPool = nullptr;
     g_stack = nullptr;
+    g_relocatable = nullptr;
     g_buddy = nullptr;
     g_stomp = nullptr;
+    g_tlsf = nullptr;
+    g_guarded = nullptr;
+
+    //Stacks free their contents on destruction, everything else still live here leaked
+    ReportMemoryLeaks(MemoryTagBit(MemoryTag::Pool) | MemoryTagBit(MemoryTag::Buddy) | MemoryTagBit(MemoryTag::Stomp) |
+        MemoryTagBit(MemoryTag::Tlsf));
+}
+
+//Sampled allocations come from the guarded slots, a miss (all slots live) falls through to the real allocator
+void* TryGuardedAlloc(size_t size, size_t alignment, MemoryTag tag)
+{
+    if (!g_guarded || !g_guarded->ShouldSample(size))
+        return nullptr;
+    return g_guarded->Allocate(size, alignment, tag);
+}
+
+bool TryGuardedFree(void* ptr)
+{
+    if (!g_guarded || !g_guarded->Owns(ptr))
+        return false;
+    g_guarded->Free(ptr);
+    return true;
 }
 
 void* PoolAlloc()
 {
+    if (g_concurrentPool)
+    {
+        if (void* guarded = TryGuardedAlloc(g_concurrentPool->GetObjectSize(), g_concurrentPool->GetAlignment(), MemoryTag::Pool))
+            return guarded;
+        return g_concurrentPool->Allocate();
+    }
+
     if (!g_pool)
     {
         std::cout << "[Pool] ERROR: pool not initialized\n";
         return nullptr;
     }
 
-    return g_pool->Allocate();
+    const PoolAllocator& pool = g_pool->GetBacking();
+    if (void* guarded = TryGuardedAlloc(pool.GetObjectSize(), pool.GetAlignment(), MemoryTag::Pool))
+        return guarded;
+    return g_pool->Allocate(pool.GetObjectSize(), pool.GetAlignment());
 }
 
 void PoolFree(void* ptr)
 {
-    if (!g_pool || !ptr) return;
-    g_pool->Free(ptr);
+    if (!ptr || TryGuardedFree(ptr)) return;
+
+    if (g_concurrentPool)
+        g_concurrentPool->Free(ptr);
+    else if (g_pool)
+        g_pool->Free(ptr, g_pool->GetBacking().GetObjectSize());
+}
+
+void PoolFlushThreadCache()
+{
+    if (g_concurrentPool)
+        g_concurrentPool->FlushThreadCache();
+}
+
+void PoolTrim()
+{
+    if (g_pool)
+        g_pool->GetBacking().Trim();
+}
+
+bool GetPoolStats(PoolStats& outStats)
+{
+    if (!g_pool)
+        return false;
+
+    g_pool->GetBacking().GetStats(outStats);
+    return true;
+}
+
+void* SmallAlloc(size_t size)
+{
+    return SmallObjectAllocator::Get().Allocate(size);
+}
+
+void SmallFree(void* ptr, size_t size)
+{
+    SmallObjectAllocator::Get().Free(ptr, size);
+}
+
+void SmallTrim()
+{
+    SmallObjectAllocator::Get().Trim();
 }
 
 void* StackAlloc(size_t size, size_t alignment)
@@ -73,7 +186,7 @@ void* StackAlloc(size_t size, size_t alignment)
 void StackReset()
 {
     if (g_stack)
-        g_stack->Reset();
+        g_stack->GetBacking().Reset();
 }
 
 void* BuddyAlloc(size_t size)
@@ -83,13 +196,77 @@ void* BuddyAlloc(size_t size)
         std::cout << "[Buddy] ERROR: buddy not initialized\n";
         return nullptr;
     }
+    if (void* guarded = TryGuardedAlloc(size, 16, MemoryTag::Buddy))
+        return guarded;
     return g_buddy->Allocate(size);
 }
 
 void BuddyDeAlloc(void* ptr)
 {
+    if (TryGuardedFree(ptr))
+        return;
     if (g_buddy)
-        g_buddy->Deallocate(ptr);
+        g_buddy->Free(ptr);
+}
+
+BuddyHandle BuddyAllocHandle(size_t size)
+{
+    if (!g_relocatable)
+    {
+        std::cout << "[Buddy] ERROR: buddy not initialized\n";
+        return {};
+    }
+    //Never sampled, a guarded slot cannot be moved by compaction
+    return g_relocatable->Allocate(size);
+}
+
+void BuddyFreeHandle(BuddyHandle handle)
+{
+    if (g_relocatable)
+        g_relocatable->Free(handle);
+}
+
+void* BuddyLock(BuddyHandle handle)
+{
+    return g_relocatable ? g_relocatable->Lock(handle) : nullptr;
+}
+
+void BuddyUnlock(BuddyHandle handle)
+{
+    if (g_relocatable)
+        g_relocatable->Unlock(handle);
+}
+
+CompactStats BuddyCompact(uint64_t budgetMicroseconds)
+{
+    if (!g_relocatable)
+        return {};
+    return g_relocatable->Compact(budgetMicroseconds);
+}
+
+float GetBuddyFragmentation()
+{
+    return g_buddy ? g_buddy->GetBacking().GetFragmentation() : 0.0f;
+}
+
+void* TlsfAlloc(size_t size)
+{
+    if (!g_tlsf)
+    {
+        std::cout << "[Tlsf] ERROR: tlsf not initialized\n";
+        return nullptr;
+    }
+    if (void* guarded = TryGuardedAlloc(size, 16, MemoryTag::Tlsf))
+        return guarded;
+    return g_tlsf->Allocate(size);
+}
+
+void TlsfDeAlloc(void* ptr)
+{
+    if (TryGuardedFree(ptr))
+        return;
+    if (g_tlsf)
+        g_tlsf->Free(ptr);
 }
 
 void* StompAlloc(size_t size)
@@ -99,18 +276,30 @@ void* StompAlloc(size_t size)
         std::cout << "[STOMP] ERROR: stomp not initialized\n";
         return nullptr;
     }
-    return g_stomp->allocate(size);
+    if (void* guarded = TryGuardedAlloc(size, 16, MemoryTag::Stomp))
+        return guarded;
+    return g_stomp->Allocate(size);
 }
 
 void StompDeAlloc(void* ptr)
 {
+    if (TryGuardedFree(ptr))
+        return;
     if (!g_stomp)
     {
         std::cout << "[STOMP] ERROR: stomp not initialized\n";
     }
     else
     {
-        g_stomp->deallocate(ptr);
+        g_stomp->Free(ptr, g_stomp->GetBacking().allocationSize(ptr));
     }
 }
 
+bool GetGuardedStats(GuardedAllocatorStats& outStats)
+{
+    if (!g_guarded)
+        return false;
+
+    g_guarded->GetStats(outStats);
+    return true;
+}
@@ -1,22 +1,64 @@
 #pragma once
 #include <cstddef>
+#include <cstdint>
+#include "VirtualMemory.hpp"
+#include "StompAllocator.hpp"
 
-void InitPool(size_t poolObjectSize, size_t poolObjectCount, size_t poolAlignment);
-void InitStack(size_t stackSize);
-void InitBuddy(size_t minBlockSize, size_t totalSize);
-void InitStomp();
+struct PoolStats;
+struct GuardedAllocatorStats;
+struct BuddyHandle;
+struct CompactStats;
+enum class MemoryTag : uint8_t;
+
+// The single threaded pool grows in chunks of poolObjectCount objects, the thread-safe pool is fixed to poolObjectCount
+void InitPool(size_t poolObjectSize, size_t poolObjectCount, size_t poolAlignment, bool threadSafe = false);
+void InitStack(size_t stackSize, ArenaBacking backing = ArenaBacking::Heap);
+void InitBuddy(size_t minBlockSize, size_t totalSize, ArenaBacking backing = ArenaBacking::Heap);
+// Variable sized payloads (texture and mesh data), no power of two rounding unlike Buddy
+void InitTlsf(size_t totalSize, ArenaBacking backing = ArenaBacking::Heap);
+// SlotRegion carves blocks from one reserved region (live blocks capped by StompRegionConfig::maxLiveSlots),
+// PerAllocation maps every block on its own
+void InitStomp(StompMode mode = StompMode::SlotRegion);
+// Routes about 1 in sampleRate Pool/Buddy/Tlsf/Stomp and GuardedSamplingResource allocations (up to one page) to guarded slots,
+// cheap enough for release builds
+void InitGuardedSampling(uint32_t sampleRate = 5000, size_t slotCount = 256);
 
 void ShutdownMemory();
 
 void* PoolAlloc();
 void  PoolFree(void* ptr);
+void  PoolFlushThreadCache(); // thread-safe pool only, call before a worker thread exits
+void  PoolTrim();             // growable pool only, returns unneeded empty chunks to the OS
+bool  GetPoolStats(PoolStats& outStats);
+
+// Size-class allocator for small objects, always available and thread-safe. Free needs the allocated size
+void* SmallAlloc(size_t size);
+void  SmallFree(void* ptr, size_t size);
+void  SmallTrim();
 
 void* StackAlloc(size_t size, size_t alignment = 16);
 void  StackReset();
 
 void* BuddyAlloc(size_t size);
 void BuddyDeAlloc(void* ptr);
+// Relocatable buddy blocks (RelocatableHeap.hpp), only locked handles have a stable address
+BuddyHandle BuddyAllocHandle(size_t size);
+void  BuddyFreeHandle(BuddyHandle handle);
+void* BuddyLock(BuddyHandle handle);
+void  BuddyUnlock(BuddyHandle handle);
+// Moves unlocked handle blocks for up to budgetMicroseconds so free space merges into large blocks
+CompactStats BuddyCompact(uint64_t budgetMicroseconds);
+float GetBuddyFragmentation();
+
+void* TlsfAlloc(size_t size);
+void TlsfDeAlloc(void* ptr);
 
 void* StompAlloc(size_t size);
 void StompDeAlloc(void* ptr);
 
+// For allocators outside this file (GuardedSamplingResource), nullptr when the allocation is not sampled
+void* TryGuardedAlloc(size_t size, size_t alignment, MemoryTag tag);
+// False when ptr is not a guarded allocation and belongs to the caller's allocator
+bool  TryGuardedFree(void* ptr);
+bool GetGuardedStats(GuardedAllocatorStats& outStats);
+
@@ -0,0 +1,151 @@
+#include "MemoryResources.hpp"
+#include "SmallObjectAllocator.hpp"
+#include "Memory.hpp"
+#include <cstdint>
+#include <new>
+
+PoolResource::PoolResource(PoolAllocator& pool, std::pmr::memory_resource* upstream)
+    : m_pool(pool),
+    m_upstream(upstream)
+{
+}
+
+bool PoolResource::Fits(size_t bytes, size_t alignment) const
+{
+    return bytes <= m_pool.GetObjectSize() && alignment <= m_pool.GetAlignment();
+}
+
+void* PoolResource::do_allocate(size_t bytes, size_t alignment)
+{
+    if (!Fits(bytes, alignment))
+        return m_upstream->allocate(bytes, alignment);
+
+    void* ptr = m_pool.Allocate();
+    if (!ptr)
+        throw std::bad_alloc();
+    return ptr;
+}
+
+void PoolResource::do_deallocate(void* ptr, size_t bytes, size_t alignment)
+{
+    //Same size and alignment as the allocation, so the same branch is taken
+    if (!Fits(bytes, alignment))
+    {
+        m_upstream->deallocate(ptr, bytes, alignment);
+        return;
+    }
+
+    m_pool.Free(ptr);
+}
+
+bool PoolResource::do_is_equal(const std::pmr::memory_resource& other) const noexcept
+{
+    return this == &other;
+}
+
+void* StackResource::do_allocate(size_t bytes, size_t alignment)
+{
+    void* ptr = m_stack.Allocate(bytes, alignment);
+    if (!ptr)
+        throw std::bad_alloc();
+    return ptr;
+}
+
+void StackResource::do_deallocate(void*, size_t, size_t)
+{
+}
+
+bool StackResource::do_is_equal(const std::pmr::memory_resource& other) const noexcept
+{
+    return this == &other;
+}
+
+void* BuddyResource::do_allocate(size_t bytes, size_t alignment)
+{
+    void* ptr = m_buddy.Allocate(bytes > alignment ? bytes : alignment);
+    if (!ptr)
+        throw std::bad_alloc();
+
+    //The arena base itself may be less aligned than a very large alignment request
+    if (reinterpret_cast<std::uintptr_t>(ptr) & (alignment - 1))
+    {
+        m_buddy.Deallocate(ptr);
+        throw std::bad_alloc();
+    }
+    return ptr;
+}
+
+void BuddyResource::do_deallocate(void* ptr, size_t, size_t)
+{
+    m_buddy.Deallocate(ptr);
+}
+
+bool BuddyResource::do_is_equal(const std::pmr::memory_resource& other) const noexcept
+{
+    return this == &other;
+}
+
+void* GuardedSamplingResource::do_allocate(size_t bytes, size_t alignment)
+{
+    if (void* guarded = TryGuardedAlloc(bytes, alignment, m_tag))
+        return guarded;
+    return m_upstream->allocate(bytes, alignment);
+}
+
+void GuardedSamplingResource::do_deallocate(void* ptr, size_t bytes, size_t alignment)
+{
+    if (!TryGuardedFree(ptr))
+        m_upstream->deallocate(ptr, bytes, alignment);
+}
+
+bool GuardedSamplingResource::do_is_equal(const std::pmr::memory_resource& other) const noexcept
+{
+    return this == &other;
+}
+
+namespace
+{
+    class SmallObjectResource : public std::pmr::memory_resource
+    {
+    private:
+        //Only the size classes that are multiples of 16 are 16 byte aligned
+        static size_t ClassBytes(size_t bytes, size_t alignment)
+        {
+            return alignment > 8 ? (bytes + 15) & ~size_t(15) : bytes;
+        }
+
+        void* do_allocate(size_t bytes, size_t alignment) override
+        {
+            if (alignment > 16)
+                return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+
+            void* ptr = SmallObjectAllocator::Get().Allocate(ClassBytes(bytes, alignment));
+            if (!ptr)
+                throw std::bad_alloc();
+            return ptr;
+        }
+
+        void do_deallocate(void* ptr, size_t bytes, size_t alignment) override
+        {
+            if (alignment > 16)
+            {
+                std::pmr::new_delete_resource()->deallocate(ptr, bytes, alignment);
+                return;
+            }
+
+            SmallObjectAllocator::Get().Free(ptr, ClassBytes(bytes, alignment));
+        }
+
+        bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override
+        {
+            return this == &other;
+        }
+    };
+}
+
+std::pmr::memory_resource* GetSmallObjectResource()
+{
+    //Leaked like the allocator itself so containers destroyed at exit can still free
+    static SmallObjectResource* resource = new SmallObjectResource();
+    return resource;
+}
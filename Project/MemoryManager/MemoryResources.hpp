@@ -0,0 +1,84 @@
+#pragma once
+#include <cstddef>
+#include <memory_resource>
+#include "PoolAllocator.hpp"
+#include "StackAllocator.hpp"
+#include "BuddyAllocator.hpp"
+#include "MemoryTracking.hpp"
+
+/*
+* std::pmr::memory_resource adapters for the engine allocators.
+* None of them lock, wrap them in a std::pmr::synchronized_pool_resource (or keep them
+* on one thread) when containers are shared between threads.
+*/
+
+// Serves blocks that fit the pool object size, bigger or stricter aligned requests go upstream
+class PoolResource : public std::pmr::memory_resource
+{
+public:
+    explicit PoolResource(PoolAllocator& pool, std::pmr::memory_resource* upstream = std::pmr::get_default_resource());
+
+    PoolAllocator& GetPool() const { return m_pool; }
+
+private:
+    void* do_allocate(size_t bytes, size_t alignment) override;
+    void do_deallocate(void* ptr, size_t bytes, size_t alignment) override;
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override;
+
+    bool Fits(size_t bytes, size_t alignment) const;
+
+    PoolAllocator& m_pool;
+    std::pmr::memory_resource* m_upstream;
+};
+
+// Monotonic: deallocate does nothing, memory comes back with Reset or FreeToMarker on the stack
+class StackResource : public std::pmr::memory_resource
+{
+public:
+    explicit StackResource(StackAllocator& stack) : m_stack(stack) {}
+
+    StackAllocator& GetStack() const { return m_stack; }
+
+private:
+    void* do_allocate(size_t bytes, size_t alignment) override;
+    void do_deallocate(void* ptr, size_t bytes, size_t alignment) override;
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override;
+
+    StackAllocator& m_stack;
+};
+
+// Blocks are aligned to their own size, so alignment is met by asking for at least that many bytes
+class BuddyResource : public std::pmr::memory_resource
+{
+public:
+    explicit BuddyResource(BuddyAllocator& buddy) : m_buddy(buddy) {}
+
+    BuddyAllocator& GetBuddy() const { return m_buddy; }
+
+private:
+    void* do_allocate(size_t bytes, size_t alignment) override;
+    void do_deallocate(void* ptr, size_t bytes, size_t alignment) override;
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override;
+
+    BuddyAllocator& m_buddy;
+};
+
+// Sends the allocations InitGuardedSampling picks to guarded slots, the rest go upstream.
+// Thread-safe when upstream is, put it in front of any pooling so single container nodes are sampled
+class GuardedSamplingResource : public std::pmr::memory_resource
+{
+public:
+    explicit GuardedSamplingResource(std::pmr::memory_resource* upstream, MemoryTag tag)
+        : m_upstream(upstream), m_tag(tag) {}
+
+private:
+    void* do_allocate(size_t bytes, size_t alignment) override;
+    void do_deallocate(void* ptr, size_t bytes, size_t alignment) override;
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override;
+
+    std::pmr::memory_resource* m_upstream;
+    MemoryTag m_tag;
+};
+
+// Process wide resource on top of SmallObjectAllocator, thread-safe
+std::pmr::memory_resource* GetSmallObjectResource();
@@ -0,0 +1,250 @@
+#include "MemoryTrace.hpp"
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <unordered_map>
+
+bool LoadMemoryTrace(const char* path, std::vector<MemoryTraceEvent>& outEvents)
+{
+    std::ifstream file(path, std::ios::binary);
+    if (!file)
+    {
+        std::cout << "[Trace] ERROR: could not open " << path << "\n";
+        return false;
+    }
+
+    MemoryTraceHeader header;
+    MemoryTraceHeader expected;
+    file.read(reinterpret_cast<char*>(&header), sizeof(header));
+    if (!file || header.magic != expected.magic || header.version != expected.version)
+    {
+        std::cout << "[Trace] ERROR: " << path << " is not a memory trace\n";
+        return false;
+    }
+
+    outEvents.resize(header.eventCount);
+    file.read(reinterpret_cast<char*>(outEvents.data()), std::streamsize(header.eventCount * sizeof(MemoryTraceEvent)));
+    if (!file)
+    {
+        std::cout << "[Trace] ERROR: " << path << " is truncated\n";
+        outEvents.clear();
+        return false;
+    }
+    return true;
+}
+
+#if MEMORY_TRACE
+
+namespace
+{
+    struct StackEntry
+    {
+        size_t allocationIndex;
+        uint32_t id;
+    };
+
+    struct ArenaState
+    {
+        uint16_t index;
+        std::vector<StackEntry> stack;     // traced stack allocations, oldest first
+    };
+
+    struct Recorder
+    {
+        std::mutex mutex;
+        std::vector<MemoryTraceEvent> events;
+        std::unordered_map<const void*, uint32_t> liveIds;
+        std::unordered_map<const void*, ArenaState> arenas;
+        uint32_t nextId = 0;
+        std::chrono::steady_clock::time_point start;
+    };
+
+    std::atomic<bool> g_running{ false };
+
+    Recorder& GetRecorder()
+    {
+        //Leaked so allocators destroyed during exit can still call in
+        static Recorder* recorder = new Recorder();
+        return *recorder;
+    }
+
+    ArenaState& GetArena(Recorder& recorder, const void* arena)
+    {
+        auto it = recorder.arenas.find(arena);
+        if (it == recorder.arenas.end())
+        {
+            ArenaState state;
+            state.index = static_cast<uint16_t>(recorder.arenas.size());
+            it = recorder.arenas.emplace(arena, std::move(state)).first;
+        }
+        return it->second;
+    }
+
+    uint64_t Now(const Recorder& recorder)
+    {
+        return uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - recorder.start).count());
+    }
+
+    uint32_t PushAlloc(Recorder& recorder, MemoryTag tag, uint16_t arena, size_t size, size_t alignment)
+    {
+        MemoryTraceEvent event;
+        event.timeNs = Now(recorder);
+        event.size = size;
+        event.id = recorder.nextId++;
+        event.alignment = static_cast<uint32_t>(alignment);
+        event.arena = arena;
+        event.tag = tag;
+        event.op = MemoryTraceOp::Alloc;
+        recorder.events.push_back(event);
+        return event.id;
+    }
+
+    void PushFree(Recorder& recorder, MemoryTag tag, uint16_t arena, uint32_t id)
+    {
+        MemoryTraceEvent event;
+        event.timeNs = Now(recorder);
+        event.id = id;
+        event.arena = arena;
+        event.tag = tag;
+        event.op = MemoryTraceOp::Free;
+        recorder.events.push_back(event);
+    }
+}
+
+bool StartMemoryTrace()
+{
+    Recorder& recorder = GetRecorder();
+    std::scoped_lock lock(recorder.mutex);
+    if (g_running.load(std::memory_order_relaxed))
+        return false;
+
+    recorder.events.clear();
+    recorder.liveIds.clear();
+    recorder.arenas.clear();
+    recorder.nextId = 0;
+    recorder.start = std::chrono::steady_clock::now();
+    g_running.store(true, std::memory_order_release);
+    return true;
+}
+
+bool StopMemoryTrace(const char* path)
+{
+    Recorder& recorder = GetRecorder();
+    std::scoped_lock lock(recorder.mutex);
+    if (!g_running.load(std::memory_order_relaxed))
+        return false;
+    g_running.store(false, std::memory_order_release);
+
+    std::ofstream file(path, std::ios::binary);
+    if (!file)
+    {
+        std::cout << "[Trace] ERROR: could not write " << path << "\n";
+        return false;
+    }
+
+    MemoryTraceHeader header;
+    header.eventCount = recorder.events.size();
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char*>(recorder.events.data()),
+        std::streamsize(recorder.events.size() * sizeof(MemoryTraceEvent)));
+
+    std::cout << "[Trace] wrote " << recorder.events.size() << " events to " << path << "\n";
+    recorder.events.clear();
+    recorder.events.shrink_to_fit();
+    recorder.liveIds.clear();
+    recorder.arenas.clear();
+    return true;
+}
+
+bool IsMemoryTraceRunning()
+{
+    return g_running.load(std::memory_order_relaxed);
+}
+
+void TraceAllocation(MemoryTag tag, const void* arena, const void* ptr, size_t size, size_t alignment)
+{
+    if (!g_running.load(std::memory_order_acquire) || !ptr)
+        return;
+
+    Recorder& recorder = GetRecorder();
+    std::scoped_lock lock(recorder.mutex);
+    if (!g_running.load(std::memory_order_relaxed))
+        return;
+
+    ArenaState& state = GetArena(recorder, arena);
+    recorder.liveIds[ptr] = PushAlloc(recorder, tag, state.index, size, alignment);
+}
+
+void TraceFree(MemoryTag tag, const void* arena, const void* ptr)
+{
+    if (!g_running.load(std::memory_order_acquire) || !ptr)
+        return;
+
+    Recorder& recorder = GetRecorder();
+    std::scoped_lock lock(recorder.mutex);
+    if (!g_running.load(std::memory_order_relaxed))
+        return;
+
+    auto it = recorder.liveIds.find(ptr);
+    if (it == recorder.liveIds.end())
+        return;
+
+    PushFree(recorder, tag, GetArena(recorder, arena).index, it->second);
+    recorder.liveIds.erase(it);
+}
+
+void TraceStackAllocation(const void* arena, const void* ptr, size_t size, size_t alignment, size_t allocationIndex)
+{
+    if (!g_running.load(std::memory_order_acquire) || !ptr)
+        return;
+
+    Recorder& recorder = GetRecorder();
+    std::scoped_lock lock(recorder.mutex);
+    if (!g_running.load(std::memory_order_relaxed))
+        return;
+
+    ArenaState& state = GetArena(recorder, arena);
+    uint32_t id = PushAlloc(recorder, MemoryTag::Stack, state.index, size, alignment);
+    state.stack.push_back({ allocationIndex, id });
+}
+
+void TraceStackRewind(const void* arena, size_t allocationCount)
+{
+    if (!g_running.load(std::memory_order_acquire))
+        return;
+
+    Recorder& recorder = GetRecorder();
+    std::scoped_lock lock(recorder.mutex);
+    if (!g_running.load(std::memory_order_relaxed))
+        return;
+
+    ArenaState& state = GetArena(recorder, arena);
+    while (!state.stack.empty() && state.stack.back().allocationIndex >= allocationCount)
+    {
+        PushFree(recorder, MemoryTag::Stack, state.index, state.stack.back().id);
+        state.stack.pop_back();
+    }
+}
+
+#else
+
+bool StartMemoryTrace()
+{
+    std::cout << "[Trace] memory tracing is compiled out, build with MEMORY_TRACE=1\n";
+    return false;
+}
+
+bool StopMemoryTrace(const char*)
+{
+    return false;
+}
+
+bool IsMemoryTraceRunning()
+{
+    return false;
+}
+
+#endif
@@ -0,0 +1,64 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "MemoryTracking.hpp"
+
+// Trace hooks follow memory tracking unless MEMORY_TRACE is set explicitly
+#ifndef MEMORY_TRACE
+#define MEMORY_TRACE MEMORY_TRACKING
+#endif
+
+enum class MemoryTraceOp : uint8_t
+{
+    Alloc,
+    Free
+};
+
+// Fixed layout, a trace file is a MemoryTraceHeader followed by eventCount events
+struct MemoryTraceEvent
+{
+    uint64_t timeNs = 0;        // since StartMemoryTrace
+    uint64_t size = 0;          // requested bytes, Alloc only
+    uint32_t id = 0;            // pairs an Alloc with its Free
+    uint32_t alignment = 0;
+    uint16_t arena = 0;         // allocator instance, numbered in order of first use
+    MemoryTag tag = MemoryTag::Pool;
+    MemoryTraceOp op = MemoryTraceOp::Alloc;
+};
+static_assert(sizeof(MemoryTraceEvent) == 32, "trace files depend on the event layout");
+
+struct MemoryTraceHeader
+{
+    uint32_t magic = 0x4352544D;    // "MTRC"
+    uint32_t version = 1;
+    uint64_t eventCount = 0;
+};
+
+/*
+* Records every allocation and free of the engine allocators while a trace is running.
+* Stack rewinds are written as individual frees, newest first, so a replay never needs
+* to know about markers. Frees of blocks allocated before the trace started are dropped.
+*/
+bool StartMemoryTrace();
+bool StopMemoryTrace(const char* path);
+bool IsMemoryTraceRunning();
+
+bool LoadMemoryTrace(const char* path, std::vector<MemoryTraceEvent>& outEvents);
+
+#if MEMORY_TRACE
+void TraceAllocation(MemoryTag tag, const void* arena, const void* ptr, size_t size, size_t alignment);
+void TraceFree(MemoryTag tag, const void* arena, const void* ptr);
+void TraceStackAllocation(const void* arena, const void* ptr, size_t size, size_t alignment, size_t allocationIndex);
+void TraceStackRewind(const void* arena, size_t allocationCount);
+
+#define MEM_TRACE_ALLOC(tag, arena, ptr, size, alignment) TraceAllocation(tag, arena, ptr, size, alignment)
+#define MEM_TRACE_FREE(tag, arena, ptr) TraceFree(tag, arena, ptr)
+#define MEM_TRACE_STACK_ALLOC(arena, ptr, size, alignment, index) TraceStackAllocation(arena, ptr, size, alignment, index)
+#define MEM_TRACE_STACK_REWIND(arena, allocationCount) TraceStackRewind(arena, allocationCount)
+#else
+#define MEM_TRACE_ALLOC(tag, arena, ptr, size, alignment) ((void)0)
+#define MEM_TRACE_FREE(tag, arena, ptr) ((void)0)
+#define MEM_TRACE_STACK_ALLOC(arena, ptr, size, alignment, index) ((void)0)
+#define MEM_TRACE_STACK_REWIND(arena, allocationCount) ((void)0)
+#endif
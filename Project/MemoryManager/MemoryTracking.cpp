@@ -0,0 +1,111 @@
+#include "MemoryTracking.hpp"
+#include <atomic>
+#include <cstdlib>
+#include <iostream>
+
+static const char* g_tagNames[] =
+{
+    "Pool",
+    "SmallObject",
+    "Stack",
+    "Buddy",
+    "Stomp",
+    "ResourcePayload",
+    "Tlsf",
+};
+static_assert(sizeof(g_tagNames) / sizeof(g_tagNames[0]) == static_cast<size_t>(MemoryTag::Count), "missing tag name");
+
+const char* GetMemoryTagName(MemoryTag tag)
+{
+    return tag < MemoryTag::Count ? g_tagNames[static_cast<size_t>(tag)] : "Unknown";
+}
+
+#if MEMORY_TRACKING
+
+namespace
+{
+    struct TagCounters
+    {
+        std::atomic<size_t> liveBytes{ 0 };
+        std::atomic<size_t> peakBytes{ 0 };
+        std::atomic<size_t> totalBytes{ 0 };
+        std::atomic<size_t> liveAllocations{ 0 };
+        std::atomic<size_t> totalAllocations{ 0 };
+    };
+
+    TagCounters g_counters[static_cast<size_t>(MemoryTag::Count)];
+
+    //Runs after main's locals are destroyed, anything still live by then is a leak
+    struct ExitLeakReport
+    {
+        ExitLeakReport() { std::atexit([]() { ReportMemoryLeaks(); }); }
+    } g_exitLeakReport;
+}
+
+void TrackAllocation(MemoryTag tag, size_t bytes, size_t count)
+{
+    TagCounters& counters = g_counters[static_cast<size_t>(tag)];
+    size_t live = counters.liveBytes.fetch_add(bytes, std::memory_order_relaxed) + bytes;
+    counters.totalBytes.fetch_add(bytes, std::memory_order_relaxed);
+    counters.liveAllocations.fetch_add(count, std::memory_order_relaxed);
+    counters.totalAllocations.fetch_add(count, std::memory_order_relaxed);
+
+    size_t peak = counters.peakBytes.load(std::memory_order_relaxed);
+    while (live > peak && !counters.peakBytes.compare_exchange_weak(peak, live, std::memory_order_relaxed)) {}
+}
+
+void TrackFree(MemoryTag tag, size_t bytes, size_t count)
+{
+    TagCounters& counters = g_counters[static_cast<size_t>(tag)];
+    counters.liveBytes.fetch_sub(bytes, std::memory_order_relaxed);
+    counters.liveAllocations.fetch_sub(count, std::memory_order_relaxed);
+}
+
+void GetMemoryTagStats(MemoryTag tag, MemoryTagStats& outStats)
+{
+    const TagCounters& counters = g_counters[static_cast<size_t>(tag)];
+    outStats.liveBytes = counters.liveBytes.load(std::memory_order_relaxed);
+    outStats.peakBytes = counters.peakBytes.load(std::memory_order_relaxed);
+    outStats.totalBytes = counters.totalBytes.load(std::memory_order_relaxed);
+    outStats.liveAllocations = counters.liveAllocations.load(std::memory_order_relaxed);
+    outStats.totalAllocations = counters.totalAllocations.load(std::memory_order_relaxed);
+}
+
+bool ReportMemoryLeaks(uint32_t tagMask)
+{
+    bool leaked = false;
+    for (size_t i = 0; i < static_cast<size_t>(MemoryTag::Count); ++i)
+    {
+        MemoryTag tag = static_cast<MemoryTag>(i);
+        if (!(tagMask & MemoryTagBit(tag)))
+            continue;
+
+        MemoryTagStats stats;
+        GetMemoryTagStats(tag, stats);
+        if (stats.liveAllocations == 0 && stats.liveBytes == 0)
+            continue;
+
+        if (!leaked)
+            std::cout << "[Memory] LEAK REPORT\n";
+        leaked = true;
+
+        std::cout << "[Memory]   " << GetMemoryTagName(tag) << ": "
+            << stats.liveAllocations << " allocations, " << stats.liveBytes << " bytes still live"
+            << " (peak " << stats.peakBytes << " bytes, " << stats.totalAllocations << " allocations total)\n";
+    }
+    return leaked;
+}
+
+#else
+
+void GetMemoryTagStats(MemoryTag, MemoryTagStats& outStats)
+{
+    outStats = MemoryTagStats{};
+}
+
+bool ReportMemoryLeaks(uint32_t)
+{
+    return false;
+}
+
+#endif
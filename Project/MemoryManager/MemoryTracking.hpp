@@ -0,0 +1,59 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+// Debug builds track allocations by default, define MEMORY_TRACKING to 0 or 1 to override
+#ifndef MEMORY_TRACKING
+#ifdef _DEBUG
+#define MEMORY_TRACKING 1
+#else
+#define MEMORY_TRACKING 0
+#endif
+#endif
+
+enum class MemoryTag : uint8_t
+{
+    Pool,
+    SmallObject,
+    Stack,
+    Buddy,
+    Stomp,
+    ResourcePayload,
+    Tlsf,
+    Count
+};
+
+constexpr uint32_t MemoryTagBit(MemoryTag tag) { return 1u << static_cast<uint32_t>(tag); }
+constexpr uint32_t AllMemoryTags = (1u << static_cast<uint32_t>(MemoryTag::Count)) - 1;
+
+struct MemoryTagStats
+{
+    size_t liveBytes = 0;
+    size_t peakBytes = 0;
+    size_t totalBytes = 0;
+    size_t liveAllocations = 0;
+    size_t totalAllocations = 0;
+};
+
+const char* GetMemoryTagName(MemoryTag tag);
+
+// Always callable, all zero when tracking is compiled out
+void GetMemoryTagStats(MemoryTag tag, MemoryTagStats& outStats);
+
+// Prints every tag in the mask that still has live allocations, returns true if something leaked
+bool ReportMemoryLeaks(uint32_t tagMask = AllMemoryTags);
+
+#if MEMORY_TRACKING
+void TrackAllocation(MemoryTag tag, size_t bytes, size_t count = 1);
+void TrackFree(MemoryTag tag, size_t bytes, size_t count = 1);
+
+#define MEM_TRACK_ALLOC(tag, bytes) TrackAllocation(tag, bytes)
+#define MEM_TRACK_FREE(tag, bytes) TrackFree(tag, bytes)
+#define MEM_TRACK_ALLOC_N(tag, bytes, count) TrackAllocation(tag, bytes, count)
+#define MEM_TRACK_FREE_N(tag, bytes, count) TrackFree(tag, bytes, count)
+#else
+#define MEM_TRACK_ALLOC(tag, bytes) ((void)0)
+#define MEM_TRACK_FREE(tag, bytes) ((void)0)
+#define MEM_TRACK_ALLOC_N(tag, bytes, count) ((void)0)
+#define MEM_TRACK_FREE_N(tag, bytes, count) ((void)0)
+#endif
@@ -0,0 +1,356 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <mutex>
+#include <new>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include "MemoryTracking.hpp"
+#include "PoolAllocator.hpp"
+#include "StackAllocator.hpp"
+#include "BuddyAllocator.hpp"
+#include "StompAllocator.hpp"
+#include "TlsfAllocator.hpp"
+
+// ---- Backings ----
+// Uniform Allocate/Free over the allocators, a request the backing cannot serve returns nullptr.
+// Quiet turns off the backing's own out of memory messages, the OOM policy decides what is reported.
+// TakesGuardBytes is false when the backing has no room for guard bytes (fixed size blocks) or
+// already catches overruns itself (the stomp allocator's guard pages)
+
+template<typename Backing>
+struct BackingTraits;
+
+template<>
+struct BackingTraits<PoolAllocator>
+{
+    static void* Allocate(PoolAllocator& pool, size_t size, size_t alignment)
+    {
+        return size <= pool.GetObjectSize() && alignment <= pool.GetAlignment() ? pool.Allocate() : nullptr;
+    }
+    static void Free(PoolAllocator& pool, void* ptr) { pool.Free(ptr); }
+    static void Quiet(PoolAllocator& pool) { pool.SetReportOutOfMemory(false); }
+    static constexpr bool TakesGuardBytes = false;
+};
+
+// Individual frees are no-ops, the owner rewinds with markers or Reset
+template<>
+struct BackingTraits<StackAllocator>
+{
+    static void* Allocate(StackAllocator& stack, size_t size, size_t alignment) { return stack.Allocate(size, alignment); }
+    static void Free(StackAllocator&, void*) {}
+    static void Quiet(StackAllocator& stack) { stack.SetReportOutOfMemory(false); }
+    static constexpr bool TakesGuardBytes = true;
+};
+
+// Blocks are aligned to their own size relative to the arena, only a heap backed arena can start less aligned than that
+template<>
+struct BackingTraits<BuddyAllocator>
+{
+    static void* Allocate(BuddyAllocator& buddy, size_t size, size_t alignment)
+    {
+        void* ptr = buddy.Allocate(size > alignment ? size : alignment);
+        if (ptr && (reinterpret_cast<uintptr_t>(ptr) & (alignment - 1)) != 0)
+        {
+            buddy.Deallocate(ptr);
+            return nullptr;
+        }
+        return ptr;
+    }
+    static void Free(BuddyAllocator& buddy, void* ptr) { buddy.Deallocate(ptr); }
+    static void Quiet(BuddyAllocator&) {}
+    static constexpr bool TakesGuardBytes = true;
+};
+
+template<>
+struct BackingTraits<StompAllocator>
+{
+    static void* Allocate(StompAllocator& stomp, size_t size, size_t alignment) { return stomp.allocate(size, alignment); }
+    static void Free(StompAllocator& stomp, void* ptr) { stomp.deallocate(ptr); }
+    static void Quiet(StompAllocator& stomp) { stomp.setReportOutOfMemory(false); }
+    static constexpr bool TakesGuardBytes = false;
+};
+
+template<>
+struct BackingTraits<TlsfAllocator>
+{
+    static void* Allocate(TlsfAllocator& tlsf, size_t size, size_t alignment)
+    {
+        return alignment <= 16 ? tlsf.Allocate(size) : nullptr;
+    }
+    static void Free(TlsfAllocator& tlsf, void* ptr) { tlsf.Deallocate(ptr); }
+    static void Quiet(TlsfAllocator&) {}
+    static constexpr bool TakesGuardBytes = true;
+};
+
+// ---- Lock policies ----
+
+struct NoLock
+{
+    void lock() {}
+    void unlock() {}
+};
+
+struct SpinLock
+{
+    void lock()
+    {
+        while (m_flag.test_and_set(std::memory_order_acquire))
+            std::this_thread::yield();
+    }
+    void unlock() { m_flag.clear(std::memory_order_release); }
+
+private:
+    std::atomic_flag m_flag = ATOMIC_FLAG_INIT;
+};
+
+struct MutexLock
+{
+    void lock() { m_mutex.lock(); }
+    void unlock() { m_mutex.unlock(); }
+
+private:
+    std::mutex m_mutex;
+};
+
+// ---- Bounds policies ----
+
+struct NoBounds
+{
+    static constexpr bool StoresSize = false;
+    static size_t StoredSize(const void*) { return 0; }
+    static size_t Overhead(size_t) { return 0; }
+    static void* Wrap(void* raw, size_t, size_t) { return raw; }
+    static void* Unwrap(void* ptr, size_t&) { return ptr; }
+};
+
+// GuardSize pattern bytes on both sides of the block, checked on free. Freed blocks are filled so stale reads stand out
+template<size_t GuardSize = 16>
+struct GuardBytes
+{
+    static constexpr uint8_t GuardPattern = 0xFD;
+    static constexpr uint8_t FreedPattern = 0xDD;
+
+    //Sits right in front of the leading guard
+    struct Header
+    {
+        size_t size;
+        size_t front;   // raw block to user pointer
+    };
+
+    static size_t Front(size_t alignment)
+    {
+        size_t front = sizeof(Header) + GuardSize;
+        return (front + alignment - 1) & ~(alignment - 1);
+    }
+
+    static size_t Overhead(size_t alignment) { return Front(alignment) + GuardSize; }
+
+    static constexpr bool StoresSize = true;
+    static size_t StoredSize(const void* ptr)
+    {
+        Header header;
+        std::memcpy(&header, static_cast<const char*>(ptr) - GuardSize - sizeof(Header), sizeof(Header));
+        return header.size;
+    }
+
+    static void* Wrap(void* raw, size_t size, size_t alignment)
+    {
+        size_t front = Front(alignment);
+        char* user = static_cast<char*>(raw) + front;
+
+        Header header{ size, front };
+        std::memcpy(user - GuardSize - sizeof(Header), &header, sizeof(Header));
+        std::memset(user - GuardSize, GuardPattern, GuardSize);
+        std::memset(user + size, GuardPattern, GuardSize);
+        return user;
+    }
+
+    // Corrects size to the allocated size when the caller passed the wrong one
+    static void* Unwrap(void* ptr, size_t& size)
+    {
+        char* user = static_cast<char*>(ptr);
+        Header header;
+        std::memcpy(&header, user - GuardSize - sizeof(Header), sizeof(Header));
+
+        if (header.size != size)
+        {
+            std::cout << "[Policy] ERROR: block " << ptr << " freed with size " << size << " but allocated with " << header.size << "\n";
+            size = header.size;
+        }
+        if (!IsIntact(user - GuardSize))
+            std::cout << "[Policy] ERROR: buffer underrun in front of " << ptr << "\n";
+        if (!IsIntact(user + header.size))
+            std::cout << "[Policy] ERROR: buffer overrun past " << ptr << " (" << header.size << " bytes)\n";
+
+        std::memset(user, FreedPattern, header.size);
+        return user - header.front;
+    }
+
+private:
+    static bool IsIntact(const char* guard)
+    {
+        for (size_t i = 0; i < GuardSize; ++i)
+        {
+            if (static_cast<uint8_t>(guard[i]) != GuardPattern)
+                return false;
+        }
+        return true;
+    }
+};
+
+// ---- Statistics policies ----
+
+struct PolicyStats
+{
+    size_t allocations = 0;
+    size_t frees = 0;
+    size_t failures = 0;
+    size_t liveBytes = 0;
+    size_t peakBytes = 0;
+};
+
+struct NoStats
+{
+    void OnAllocate(size_t) {}
+    void OnFree(size_t) {}
+    void OnFailure() {}
+    void GetStats(PolicyStats& outStats) const { outStats = {}; }
+};
+
+// Plain counters, they are only touched under the allocator's lock
+struct CountingStats
+{
+    void OnAllocate(size_t size)
+    {
+        ++m_stats.allocations;
+        m_stats.liveBytes += size;
+        if (m_stats.liveBytes > m_stats.peakBytes)
+            m_stats.peakBytes = m_stats.liveBytes;
+    }
+    void OnFree(size_t size)
+    {
+        ++m_stats.frees;
+        m_stats.liveBytes -= size;
+    }
+    void OnFailure() { ++m_stats.failures; }
+    void GetStats(PolicyStats& outStats) const { outStats = m_stats; }
+
+private:
+    PolicyStats m_stats;
+};
+
+// ---- Out of memory policies ----
+
+struct ReturnNull
+{
+    static void* OnOutOfMemory(size_t) { return nullptr; }
+};
+
+struct ReportOom
+{
+    static void* OnOutOfMemory(size_t size)
+    {
+        std::cout << "[Policy] ERROR: out of memory allocating " << size << " bytes\n";
+        return nullptr;
+    }
+};
+
+struct ThrowOom
+{
+    static void* OnOutOfMemory(size_t) { throw std::bad_alloc(); }
+};
+
+/*
+* Allocator put together from compile-time policies around one of the engine allocators.
+* The policies are empty base classes when they do nothing, so the release configuration
+* compiles down to the backing allocator's own calls. Free takes the allocated size like the
+* pmr resources do, the guard policy checks it against what was allocated. Backings that cannot
+* take guard bytes always run without them, so debug and release accept the same requests.
+*/
+template<typename Backing, typename LockPolicy, typename BoundsPolicy, typename StatsPolicy, typename OomPolicy>
+class PolicyAllocator : private LockPolicy, private StatsPolicy
+{
+    using Bounds = std::conditional_t<BackingTraits<Backing>::TakesGuardBytes, BoundsPolicy, NoBounds>;
+
+public:
+    template<typename... Args>
+    explicit PolicyAllocator(Args&&... args) : m_backing(std::forward<Args>(args)...)
+    {
+        BackingTraits<Backing>::Quiet(m_backing);
+    }
+
+    PolicyAllocator(const PolicyAllocator&) = delete;
+    PolicyAllocator& operator=(const PolicyAllocator&) = delete;
+
+    void* Allocate(size_t size, size_t alignment = alignof(std::max_align_t))
+    {
+        void* raw;
+        {
+            std::scoped_lock lock(static_cast<LockPolicy&>(*this));
+            raw = BackingTraits<Backing>::Allocate(m_backing, size + Bounds::Overhead(alignment), alignment);
+            if (raw)
+                StatsPolicy::OnAllocate(size);
+            else
+                StatsPolicy::OnFailure();
+        }
+
+        //Outside the lock, the policy may throw
+        if (!raw)
+            return OomPolicy::OnOutOfMemory(size);
+        return Bounds::Wrap(raw, size, alignment);
+    }
+
+    void Free(void* ptr, size_t size)
+    {
+        if (!ptr)
+            return;
+
+        void* raw = Bounds::Unwrap(ptr, size);
+        std::scoped_lock lock(static_cast<LockPolicy&>(*this));
+        StatsPolicy::OnFree(size);
+        BackingTraits<Backing>::Free(m_backing, raw);
+    }
+
+    // For callers that do not keep the size, the bounds policy has to record it unless nothing is counted
+    void Free(void* ptr)
+    {
+        static_assert(Bounds::StoresSize || std::is_same_v<StatsPolicy, NoStats>,
+            "Free without a size needs a bounds policy that stores it");
+        if (ptr)
+            Free(ptr, Bounds::StoredSize(ptr));
+    }
+
+    void GetStats(PolicyStats& outStats)
+    {
+        std::scoped_lock lock(static_cast<LockPolicy&>(*this));
+        StatsPolicy::GetStats(outStats);
+    }
+
+    // Backing specific calls (markers, Trim, ...) are not locked
+    Backing& GetBacking() { return m_backing; }
+    const Backing& GetBacking() const { return m_backing; }
+
+private:
+    Backing m_backing;
+};
+
+// Full checking for debugging, same locking as the release version so threading behaviour does not change
+template<typename Backing, typename LockPolicy = NoLock>
+using DebugAllocator = PolicyAllocator<Backing, LockPolicy, GuardBytes<16>, CountingStats, ReportOom>;
+
+template<typename Backing, typename LockPolicy = NoLock>
+using ReleaseAllocator = PolicyAllocator<Backing, LockPolicy, NoBounds, NoStats, ReturnNull>;
+
+// Follows MEMORY_TRACKING, so debug builds check and release builds do not
+#if MEMORY_TRACKING
+template<typename Backing, typename LockPolicy = NoLock>
+using ConfiguredAllocator = DebugAllocator<Backing, LockPolicy>;
+#else
+template<typename Backing, typename LockPolicy = NoLock>
+using ConfiguredAllocator = ReleaseAllocator<Backing, LockPolicy>;
+#endif
@@ -1,35 +1,225 @@
 #include <iostream>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
 #include "PoolAllocator.hpp"
+#include "MemoryTrace.hpp"
+#include "VirtualMemory.hpp"
+#include "BitUtils.hpp"
 
-PoolAllocator::PoolAllocator(size_t objectSize, size_t objectCount, size_t alignment)
+PoolAllocator::PoolAllocator(size_t objectSize, size_t objectsPerChunk, size_t alignment, const PoolGrowthPolicy& policy,
+    MemoryTag tag)
     : m_objectSize(objectSize),
-    m_objectCount(objectCount),
+    m_objectsPerChunk(objectsPerChunk),
     m_alignment(alignment),
-    m_rawMemory(nullptr),
-    m_memoryBlock(nullptr),
-    m_freeListHead(nullptr)
+    m_chunkBytes(0),
+    m_chunkShift(0),
+    m_headerBytes(0),
+    m_policy(policy),
+    m_tag(tag)
 {
+    if (m_alignment < alignof(void*)) {
+        m_alignment = alignof(void*);
+    }
 
-    m_objectSize = (objectSize + (alignment - 1)) & ~(alignment - 1);
+    m_objectSize = (objectSize + (m_alignment - 1)) & ~(m_alignment - 1);
 
     if (m_objectSize < sizeof(void*)) {
         m_objectSize = sizeof(void*);
     }
-    
-    size_t totalSize = m_objectSize * objectCount;
 
-    m_rawMemory = std::malloc(totalSize + alignment);
-    if (!m_rawMemory) {
+    if (m_objectsPerChunk == 0) {
+        m_objectsPerChunk = 1;
+    }
+
+    m_headerBytes = (sizeof(Chunk) + (m_alignment - 1)) & ~(m_alignment - 1);
+
+    //Round the chunk up to a power of two (whole pages, so it can be decommitted) and use the slack for extra objects
+    size_t pageSize = VirtualMemory::GetPageSize();
+    m_chunkShift = CeilLog2(m_headerBytes + m_objectSize * m_objectsPerChunk);
+    if ((size_t(1) << m_chunkShift) < pageSize) {
+        m_chunkShift = CeilLog2(pageSize);
+    }
+    if ((size_t(1) << m_chunkShift) < m_alignment) {
+        m_chunkShift = CeilLog2(m_alignment);
+    }
+    m_chunkBytes = size_t(1) << m_chunkShift;
+    m_objectsPerChunk = (m_chunkBytes - m_headerBytes) / m_objectSize;
+
+    //Reserve every chunk slot up front, only live chunks are committed
+    m_slotCount = m_policy.maxChunks != 0 ? m_policy.maxChunks : m_policy.reservedBytes >> m_chunkShift;
+    if (m_slotCount == 0) {
+        m_slotCount = 1;
+    }
+    size_t alignmentSlack = m_alignment > pageSize ? m_alignment : 0;
+    m_reservedBytes = (m_slotCount << m_chunkShift) + alignmentSlack;
+    m_reservedBase = static_cast<char*>(VirtualMemory::Reserve(m_reservedBytes));
+    if (!m_reservedBase) {
+        throw std::bad_alloc();
+    }
+    std::uintptr_t base = reinterpret_cast<std::uintptr_t>(m_reservedBase);
+    m_base = m_reservedBase + (((base + (m_alignment - 1)) & ~(std::uintptr_t(m_alignment) - 1)) - base);
+    m_usedSlots.assign((m_slotCount + 63) / 64, 0);
+
+    //First chunk up front so the common case never grows
+    if (!AddChunk()) {
+        VirtualMemory::Release(m_reservedBase, m_reservedBytes);
         throw std::bad_alloc();
     }
+}
+
+PoolAllocator::~PoolAllocator()
+{
+    VirtualMemory::Release(m_reservedBase, m_reservedBytes);
+}
+
+void* PoolAllocator::Allocate()
+{
+    if (m_availableHead == nullptr)
+    {
+        if (m_policy.maxChunks != 0 && m_chunkCount >= m_policy.maxChunks)
+            return nullptr;
+
+        if (!AddChunk())
+            return nullptr;
+    }
+
+    Chunk* chunk = m_availableHead;
+    void* allocated = chunk->freeListHead;
+    chunk->freeListHead = *reinterpret_cast<void**>(allocated);
+
+    if (chunk->used == 0)
+        --m_emptyChunkCount;
+
+    ++chunk->used;
+    ++m_used;
+    if (m_used > m_highWater)
+        m_highWater = m_used;
+
+    if (chunk->freeListHead == nullptr)
+        RemoveAvailable(chunk);
+
+    MEM_TRACK_ALLOC(m_tag, m_objectSize);
+    MEM_TRACE_ALLOC(m_tag, this, allocated, m_objectSize, m_alignment);
+    return allocated;
+}
+
+void PoolAllocator::Free(void* ptr)
+{
+    if (!ptr)
+        return;
+
+    Chunk* chunk = ChunkOf(ptr);
+    if (!chunk)
+    {
+        std::cout << "[Pool] ERROR: " << ptr << " is not an object of this pool\n";
+        return;
+    }
+
+    MEM_TRACK_FREE(m_tag, m_objectSize);
+    MEM_TRACE_FREE(m_tag, this, ptr);
+
+    *reinterpret_cast<void**>(ptr) = chunk->freeListHead;
+    chunk->freeListHead = ptr;
+
+    --chunk->used;
+    --m_used;
+
+    if (!chunk->available)
+        PushAvailableFront(chunk);
+
+    if (chunk->used == 0)
+    {
+        ++m_emptyChunkCount;
+        RemoveAvailable(chunk);
+
+        if (CanRelease())
+        {
+            ReleaseChunk(chunk);
+        }
+        else
+        {
+            //Empty chunks go last so partially used chunks fill up first
+            PushAvailableBack(chunk);
+        }
+    }
+}
+
+void PoolAllocator::Trim()
+{
+    m_highWater = m_used;
+
+    Chunk* chunk = m_allChunks;
+    while (chunk)
+    {
+        Chunk* next = chunk->allNext;
+        if (chunk->used == 0 && CanRelease())
+        {
+            RemoveAvailable(chunk);
+            ReleaseChunk(chunk);
+        }
+        chunk = next;
+    }
+}
+
+void PoolAllocator::GetStats(PoolStats& outStats) const
+{
+    outStats.objectSize = m_objectSize;
+    outStats.chunkCount = m_chunkCount;
+    outStats.emptyChunkCount = m_emptyChunkCount;
+    outStats.capacity = m_chunkCount * m_objectsPerChunk;
+    outStats.used = m_used;
+    outStats.highWater = m_highWater;
+    outStats.chunksAllocated = m_chunksAllocated;
+    outStats.chunksReleased = m_chunksReleased;
+}
+
+void PoolAllocator::GetChunkStats(std::vector<PoolChunkStats>& outChunks) const
+{
+    outChunks.clear();
+    outChunks.reserve(m_chunkCount);
+    for (Chunk* chunk = m_allChunks; chunk; chunk = chunk->allNext)
+    {
+        PoolChunkStats stats;
+        stats.capacity = m_objectsPerChunk;
+        stats.used = chunk->used;
+        outChunks.push_back(stats);
+    }
+}
+
+PoolAllocator::Chunk* PoolAllocator::AddChunk()
+{
+    //Lowest free slot, keeps live chunks packed towards the start of the range
+    size_t word = m_firstFreeSlot / 64;
+    while (word < m_usedSlots.size() && m_usedSlots[word] == ~uint64_t(0))
+        ++word;
+    size_t slot = word < m_usedSlots.size() ? word * 64 + FindFirstSet(~m_usedSlots[word]) : m_slotCount;
+    if (slot >= m_slotCount)
+    {
+        if (m_reportOutOfMemory)
+            std::cout << "[Pool] ERROR: all " << m_slotCount << " reserved chunks in use\n";
+        return nullptr;
+    }
+
+    char* memory = m_base + (slot << m_chunkShift);
+    if (!VirtualMemory::Commit(memory, m_chunkBytes))
+    {
+        if (m_reportOutOfMemory)
+            std::cout << "[Pool] ERROR: failed to commit chunk of " << m_chunkBytes << " bytes\n";
+        return nullptr;
+    }
+    m_usedSlots[slot / 64] |= uint64_t(1) << (slot % 64);
+    m_firstFreeSlot = slot + 1;
 
-    std::uintptr_t rawAddr = reinterpret_cast<std::uintptr_t>(m_rawMemory);
-    std::uintptr_t alignedAddr = (rawAddr + (alignment - 1)) & ~(alignment - 1);
-    m_memoryBlock = reinterpret_cast<void*>(alignedAddr);
+    Chunk* chunk = reinterpret_cast<Chunk*>(memory);
+    chunk->prev = chunk->next = nullptr;
+    chunk->used = 0;
+    chunk->available = false;
 
-    char* current = static_cast<char*>(m_memoryBlock);
+    char* current = memory + m_headerBytes;
+    chunk->freeListHead = current;
 
-    for (size_t i = 0; i < objectCount - 1; ++i)
+    for (size_t i = 0; i < m_objectsPerChunk - 1; ++i)
     {
         void* next = current + m_objectSize;
         *reinterpret_cast<void**>(current) = next;
@@ -37,31 +227,105 @@ PoolAllocator::PoolAllocator(size_t objectSize, size_t objectCount, size_t align
     }
 
     *reinterpret_cast<void**>(current) = nullptr;
-    m_freeListHead = m_memoryBlock;
+
+    chunk->allPrev = nullptr;
+    chunk->allNext = m_allChunks;
+    if (m_allChunks)
+        m_allChunks->allPrev = chunk;
+    m_allChunks = chunk;
+
+    ++m_chunkCount;
+    ++m_emptyChunkCount;
+    ++m_chunksAllocated;
+
+    PushAvailableFront(chunk);
+    return chunk;
 }
 
-PoolAllocator::~PoolAllocator()
+void PoolAllocator::ReleaseChunk(Chunk* chunk)
+{
+    if (chunk->allPrev)
+        chunk->allPrev->allNext = chunk->allNext;
+    else
+        m_allChunks = chunk->allNext;
+    if (chunk->allNext)
+        chunk->allNext->allPrev = chunk->allPrev;
+
+    --m_chunkCount;
+    --m_emptyChunkCount;
+    ++m_chunksReleased;
+
+    size_t slot = size_t(reinterpret_cast<char*>(chunk) - m_base) >> m_chunkShift;
+    m_usedSlots[slot / 64] &= ~(uint64_t(1) << (slot % 64));
+    if (slot < m_firstFreeSlot)
+        m_firstFreeSlot = slot;
+    VirtualMemory::Decommit(chunk, m_chunkBytes);
+}
+
+bool PoolAllocator::CanRelease() const
 {
-    std::free(m_rawMemory);
+    if (m_emptyChunkCount <= m_policy.retainedEmptyChunks)
+        return false;
+
+    //Keep enough capacity to cover the high-water mark of this window
+    size_t capacityAfter = (m_chunkCount - 1) * m_objectsPerChunk;
+    return capacityAfter >= m_highWater;
 }
 
-void* PoolAllocator::Allocate()
+PoolAllocator::Chunk* PoolAllocator::ChunkOf(void* ptr) const
 {
-    if (m_freeListHead == nullptr)
+    //Slot by shift, then ptr has to be the start of an object in a live chunk
+    std::uintptr_t offset = reinterpret_cast<std::uintptr_t>(ptr) - reinterpret_cast<std::uintptr_t>(m_base);
+    size_t slot = offset >> m_chunkShift;
+    if (slot >= m_slotCount || !((m_usedSlots[slot / 64] >> (slot % 64)) & 1))
         return nullptr;
 
-    void* allocated = m_freeListHead;
+    size_t inChunk = offset & (m_chunkBytes - 1);
+    if (inChunk < m_headerBytes || (inChunk - m_headerBytes) % m_objectSize != 0 ||
+        (inChunk - m_headerBytes) / m_objectSize >= m_objectsPerChunk)
+        return nullptr;
+    return reinterpret_cast<Chunk*>(m_base + (slot << m_chunkShift));
+}
 
-    m_freeListHead = *reinterpret_cast<void**>(m_freeListHead);
+void PoolAllocator::PushAvailableFront(Chunk* chunk)
+{
+    chunk->prev = nullptr;
+    chunk->next = m_availableHead;
+    if (m_availableHead)
+        m_availableHead->prev = chunk;
+    else
+        m_availableTail = chunk;
+    m_availableHead = chunk;
+    chunk->available = true;
+}
 
-    return allocated;
+void PoolAllocator::PushAvailableBack(Chunk* chunk)
+{
+    chunk->next = nullptr;
+    chunk->prev = m_availableTail;
+    if (m_availableTail)
+        m_availableTail->next = chunk;
+    else
+        m_availableHead = chunk;
+    m_availableTail = chunk;
+    chunk->available = true;
 }
 
-void PoolAllocator::Free(void* ptr)
+void PoolAllocator::RemoveAvailable(Chunk* chunk)
 {
-    if (!ptr)
+    if (!chunk->available)
         return;
 
-    *reinterpret_cast<void**>(ptr) = m_freeListHead;
-    m_freeListHead = ptr;
-}
\ No newline at end of file
+    if (chunk->prev)
+        chunk->prev->next = chunk->next;
+    else
+        m_availableHead = chunk->next;
+
+    if (chunk->next)
+        chunk->next->prev = chunk->prev;
+    else
+        m_availableTail = chunk->prev;
+
+    chunk->prev = chunk->next = nullptr;
+    chunk->available = false;
+}
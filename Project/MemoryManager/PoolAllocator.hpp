@@ -1,18 +1,112 @@
 #pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "MemoryTracking.hpp"
 
+struct PoolGrowthPolicy
+{
+    size_t maxChunks = 0;              // 0 = grow until reservedBytes are used up
+    size_t reservedBytes = size_t(256) * 1024 * 1024;  // address space the chunks are carved from when maxChunks is 0
+    size_t retainedEmptyChunks = 1;    // fully free chunks kept around before they go back to the OS
+};
+
+struct PoolChunkStats
+{
+    size_t capacity = 0;
+    size_t used = 0;
+};
+
+struct PoolStats
+{
+    size_t objectSize = 0;
+    size_t chunkCount = 0;
+    size_t emptyChunkCount = 0;
+    size_t capacity = 0;
+    size_t used = 0;
+    size_t highWater = 0;
+    size_t chunksAllocated = 0;
+    size_t chunksReleased = 0;
+};
+
+/*
+* Fixed size object pool made of chained chunks.
+* Chunks sit in one reserved range at a power of two stride (the objects fill the whole stride),
+* so Free finds the owning chunk with a shift. New chunks are added when every chunk is full and empty chunks are released again
+* once they are not needed to cover the high-water mark.
+*/
 class PoolAllocator
 {
 public:
-    PoolAllocator(size_t objectSize, size_t objectCount, size_t alignment);
+    PoolAllocator(size_t objectSize, size_t objectsPerChunk, size_t alignment, const PoolGrowthPolicy& policy = {},
+        MemoryTag tag = MemoryTag::Pool);
     ~PoolAllocator();
 
+    PoolAllocator(const PoolAllocator&) = delete;
+    PoolAllocator& operator=(const PoolAllocator&) = delete;
+
     void* Allocate();
     void Free(void* ptr);
+
+    // Releases empty chunks above the current high-water mark and starts a new high-water window
+    void Trim();
+
+    void GetStats(PoolStats& outStats) const;
+    void GetChunkStats(std::vector<PoolChunkStats>& outChunks) const;
+
+    size_t GetObjectSize() const { return m_objectSize; }
+    size_t GetAlignment() const { return m_alignment; }
+
+    // Off when a wrapper reports failed allocations itself
+    void SetReportOutOfMemory(bool report) { m_reportOutOfMemory = report; }
+
 private:
+    struct Chunk
+    {
+        Chunk* prev;        // available list (chunks with free slots)
+        Chunk* next;
+        Chunk* allPrev;     // every chunk
+        Chunk* allNext;
+        void* freeListHead;
+        size_t used;
+        bool available;
+    };
+
+    Chunk* AddChunk();
+    void ReleaseChunk(Chunk* chunk);
+    bool CanRelease() const;
+
+    Chunk* ChunkOf(void* ptr) const;
+
+    void PushAvailableFront(Chunk* chunk);
+    void PushAvailableBack(Chunk* chunk);
+    void RemoveAvailable(Chunk* chunk);
+
     size_t m_objectSize;
-    size_t m_objectCount;
+    size_t m_objectsPerChunk;
     size_t m_alignment;
-    void* m_rawMemory;
-    void* m_memoryBlock;
-    void* m_freeListHead;
-};
\ No newline at end of file
+    size_t m_chunkBytes;        // stride, power of two and at least a page
+    uint32_t m_chunkShift;
+    size_t m_headerBytes;
+    PoolGrowthPolicy m_policy;
+    MemoryTag m_tag;
+
+    Chunk* m_availableHead = nullptr;
+    Chunk* m_availableTail = nullptr;
+    Chunk* m_allChunks = nullptr;
+
+    char* m_reservedBase = nullptr;
+    size_t m_reservedBytes = 0;
+    char* m_base = nullptr;                 // first chunk slot, m_reservedBase aligned up
+    size_t m_slotCount = 0;
+    std::vector<uint64_t> m_usedSlots;      // bit set = chunk slot holds a live chunk
+    size_t m_firstFreeSlot = 0;             // no free slot below this
+
+    size_t m_chunkCount = 0;
+    size_t m_emptyChunkCount = 0;
+    size_t m_used = 0;
+    size_t m_highWater = 0;
+    size_t m_chunksAllocated = 0;
+    size_t m_chunksReleased = 0;
+    bool m_reportOutOfMemory = true;
+};
@@ -0,0 +1,156 @@
+#include "RelocatableHeap.hpp"
+#include <chrono>
+#include <cstring>
+#include <iostream>
+
+RelocatableHeap::RelocatableHeap(BuddyAllocator& buddy)
+	: m_buddy(buddy)
+{
+}
+
+RelocatableHeap::~RelocatableHeap()
+{
+	if (m_liveHandles != 0)
+		std::cout << "[Relocatable] ERROR: " << m_liveHandles << " handles still allocated, freeing them\n";
+
+	for (Entry& entry : m_entries)
+	{
+		if (entry.ptr)
+			m_buddy.Deallocate(entry.ptr);
+	}
+}
+
+BuddyHandle RelocatableHeap::Allocate(size_t size)
+{
+	void* ptr = m_buddy.Allocate(size);
+	if (!ptr)
+		return {};
+
+	uint32_t index;
+	if (m_freeHead != InvalidIndex)
+	{
+		index = m_freeHead;
+		m_freeHead = m_entries[index].nextFree;
+	}
+	else
+	{
+		index = static_cast<uint32_t>(m_entries.size());
+		m_entries.emplace_back();
+	}
+
+	Entry& entry = m_entries[index];
+	entry.ptr = static_cast<char*>(ptr);
+	entry.size = size;
+	entry.lockCount = 0;
+	entry.nextFree = InvalidIndex;
+	++m_liveHandles;
+
+	return BuddyHandle{ index, entry.generation };
+}
+
+void RelocatableHeap::Free(BuddyHandle handle)
+{
+	Entry* entry = Resolve(handle);
+	if (!entry)
+	{
+		std::cout << "[Relocatable] ERROR: free of stale or invalid handle\n";
+		return;
+	}
+	if (entry->lockCount != 0)
+		std::cout << "[Relocatable] ERROR: handle freed while locked\n";
+
+	m_buddy.Deallocate(entry->ptr);
+	entry->ptr = nullptr;
+	entry->size = 0;
+	entry->lockCount = 0;
+
+	//Bump the generation so old copies of the handle stop resolving, 0 is kept for the null handle
+	if (++entry->generation == 0)
+		entry->generation = 1;
+
+	entry->nextFree = m_freeHead;
+	m_freeHead = handle.index;
+	--m_liveHandles;
+}
+
+void* RelocatableHeap::Lock(BuddyHandle handle)
+{
+	Entry* entry = Resolve(handle);
+	if (!entry)
+		return nullptr;
+
+	++entry->lockCount;
+	return entry->ptr;
+}
+
+void RelocatableHeap::Unlock(BuddyHandle handle)
+{
+	Entry* entry = Resolve(handle);
+	if (!entry || entry->lockCount == 0)
+	{
+		std::cout << "[Relocatable] ERROR: unlock without a matching lock\n";
+		return;
+	}
+	--entry->lockCount;
+}
+
+size_t RelocatableHeap::GetSize(BuddyHandle handle) const
+{
+	const Entry* entry = Resolve(handle);
+	return entry ? entry->size : 0;
+}
+
+CompactStats RelocatableHeap::Compact(uint64_t budgetMicroseconds)
+{
+	using Clock = std::chrono::steady_clock;
+	const Clock::time_point deadline = Clock::now() + std::chrono::microseconds(budgetMicroseconds);
+
+	CompactStats stats;
+	if (m_buddy.GetFragmentation() == 0.0f)
+	{
+		m_compactCursor = 0;
+		stats.finished = true;
+		return stats;
+	}
+
+	//One pass over the handle table is spread over as many calls as the budget needs
+	for (; m_compactCursor < m_entries.size(); ++m_compactCursor)
+	{
+		Entry& entry = m_entries[m_compactCursor];
+		if (!entry.ptr || entry.lockCount != 0)
+			continue;
+		if (Clock::now() >= deadline)
+			return stats;
+
+		void* target = m_buddy.AllocateBelow(entry.size, entry.ptr);
+		if (!target)
+			continue;
+
+		std::memcpy(target, entry.ptr, entry.size);
+		m_buddy.Deallocate(entry.ptr);
+		entry.ptr = static_cast<char*>(target);
+
+		++stats.movedBlocks;
+		stats.movedBytes += entry.size;
+	}
+
+	m_compactCursor = 0;
+	stats.finished = true;
+	return stats;
+}
+
+RelocatableHeap::Entry* RelocatableHeap::Resolve(BuddyHandle handle)
+{
+	return const_cast<Entry*>(static_cast<const RelocatableHeap*>(this)->Resolve(handle));
+}
+
+const RelocatableHeap::Entry* RelocatableHeap::Resolve(BuddyHandle handle) const
+{
+	if (handle.index >= m_entries.size())
+		return nullptr;
+
+	const Entry& entry = m_entries[handle.index];
+	if (entry.generation != handle.generation || !entry.ptr)
+		return nullptr;
+	return &entry;
+}
@@ -0,0 +1,76 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include "BuddyAllocator.hpp"
+
+//Index into the handle table plus the generation it was issued with, a stale handle resolves to nothing
+struct BuddyHandle
+{
+	uint32_t index = 0;
+	uint32_t generation = 0;	//0 = null handle
+
+	explicit operator bool() const { return generation != 0; }
+	bool operator==(const BuddyHandle& other) const { return index == other.index && generation == other.generation; }
+	bool operator!=(const BuddyHandle& other) const { return !(*this == other); }
+};
+
+struct CompactStats
+{
+	size_t movedBlocks = 0;
+	size_t movedBytes = 0;
+	bool finished = false;		//a pass over every handle completed, the next call starts a new one
+};
+
+/*
+* Relocatable allocations on top of a BuddyAllocator.
+* Callers keep handles and Lock them to get the current address, the pointer is only valid until the matching Unlock.
+* Compact moves unlocked blocks to a free block below them, which packs live data towards the arena start
+* so the free space above merges back into large buddies. Raw Allocate calls on the same buddy are never moved.
+*/
+class RelocatableHeap
+{
+public:
+	explicit RelocatableHeap(BuddyAllocator& buddy);
+	~RelocatableHeap();
+
+	RelocatableHeap(const RelocatableHeap&) = delete;
+	RelocatableHeap& operator=(const RelocatableHeap&) = delete;
+
+	BuddyHandle Allocate(size_t size);
+	void Free(BuddyHandle handle);
+
+	//Locks nest, a block is movable again once every Lock has its Unlock
+	void* Lock(BuddyHandle handle);
+	void Unlock(BuddyHandle handle);
+
+	bool IsValid(BuddyHandle handle) const { return Resolve(handle) != nullptr; }
+	size_t GetSize(BuddyHandle handle) const;
+	size_t GetLiveHandles() const { return m_liveHandles; }
+
+	//Moves blocks until the budget runs out, call once a frame with a small budget. Each call carries on where the last one stopped
+	CompactStats Compact(uint64_t budgetMicroseconds);
+	float GetFragmentation() const { return m_buddy.GetFragmentation(); }
+
+	BuddyAllocator& GetBuddy() const { return m_buddy; }
+
+private:
+	struct Entry
+	{
+		char* ptr = nullptr;
+		size_t size = 0;
+		uint32_t generation = 1;
+		uint32_t lockCount = 0;
+		uint32_t nextFree = InvalidIndex;
+	};
+
+	static constexpr uint32_t InvalidIndex = UINT32_MAX;
+
+	Entry* Resolve(BuddyHandle handle);
+	const Entry* Resolve(BuddyHandle handle) const;
+
+	BuddyAllocator& m_buddy;
+	std::vector<Entry> m_entries;
+	uint32_t m_freeHead = InvalidIndex;
+	size_t m_liveHandles = 0;
+	uint32_t m_compactCursor = 0;	//next entry Compact looks at
+};
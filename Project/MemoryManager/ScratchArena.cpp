@@ -0,0 +1,49 @@
+#include "ScratchArena.hpp"
+#include "MemoryResources.hpp"
+
+namespace
+{
+    struct ThreadScratch
+    {
+        ThreadScratch()
+            : stack(ThreadScratchCapacity, ArenaBacking::VirtualMemory, StackOverflowMode::ChainBlocks),
+            resource(stack)
+        {
+        }
+
+        StackAllocator stack;
+        StackResource resource;
+    };
+
+    ThreadScratch& GetScratch()
+    {
+        //Created on the thread's first use, destroyed when the thread exits
+        thread_local ThreadScratch scratch;
+        return scratch;
+    }
+}
+
+StackAllocator& GetThreadScratch()
+{
+    return GetScratch().stack;
+}
+
+std::pmr::memory_resource* GetThreadScratchResource()
+{
+    return &GetScratch().resource;
+}
+
+ScratchScope::ScratchScope()
+    : m_stack(GetThreadScratch()), m_marker(m_stack.GetMarker())
+{
+}
+
+ScratchScope::~ScratchScope()
+{
+    //Only Reset folds overflow blocks into the primary block, a plain rewind keeps the committed pages for the next job
+    bool outermost = m_marker.blockIndex == 0 && m_marker.offset == 0;
+    if (outermost && m_stack.GetOverflowBlockCount() != 0)
+        m_stack.Reset();
+    else
+        m_stack.FreeToMarker(m_marker);
+}
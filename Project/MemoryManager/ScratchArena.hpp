@@ -0,0 +1,39 @@
+#pragma once
+#include <cstddef>
+#include <memory_resource>
+#include "StackAllocator.hpp"
+
+/*
+* Per-thread linear scratch memory for temporaries (file buffers, decode staging, parser text).
+* Every thread gets its own StackAllocator on first use: a large virtual reservation that only
+* commits what the thread actually needed, so after the first big job the same pages are reused
+* instead of going through malloc/free every time. Nothing here locks, scratch memory never
+* leaves the thread that allocated it.
+*/
+
+// Reserved per thread, pages are committed on demand and blocks are chained if a job needs more
+constexpr size_t ThreadScratchCapacity = 256 * 1024 * 1024;
+
+StackAllocator& GetThreadScratch();
+
+// Monotonic pmr resource over the thread's scratch, for pmr::vector/pmr::string temporaries
+std::pmr::memory_resource* GetThreadScratchResource();
+
+// Rewinds the thread's scratch to the marker taken on construction. The outermost scope of a job
+// also folds overflow blocks back into one bigger primary block, so the next job does not overflow
+class ScratchScope
+{
+public:
+    ScratchScope();
+    ~ScratchScope();
+
+    ScratchScope(const ScratchScope&) = delete;
+    ScratchScope& operator=(const ScratchScope&) = delete;
+
+    void* Allocate(size_t size, size_t alignment = alignof(std::max_align_t)) { return m_stack.Allocate(size, alignment); }
+    std::pmr::memory_resource* GetResource() const { return GetThreadScratchResource(); }
+
+private:
+    StackAllocator& m_stack;
+    StackMarker m_marker;
+};
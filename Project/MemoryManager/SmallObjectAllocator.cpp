@@ -0,0 +1,104 @@
+#include "SmallObjectAllocator.hpp"
+#include "MemoryTrace.hpp"
+
+static constexpr size_t g_classSizes[] =
+{
+    8, 16, 24, 32, 48, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320, 384, 448, 512
+};
+
+SmallObjectAllocator& SmallObjectAllocator::Get()
+{
+    //Never destroyed, containers in other statics may still free into it during shutdown
+    static SmallObjectAllocator* instance = new SmallObjectAllocator();
+    return *instance;
+}
+
+SmallObjectAllocator::SmallObjectAllocator()
+{
+    static_assert(sizeof(g_classSizes) / sizeof(g_classSizes[0]) == ClassCount, "size class table mismatch");
+
+    for (size_t i = 0; i < ClassCount; ++i)
+    {
+        SizeClass& sizeClass = m_classes[i];
+        sizeClass.size = g_classSizes[i];
+
+        //Roughly 16 KB chunks, at least 32 objects each
+        size_t objectsPerChunk = 16 * 1024 / sizeClass.size;
+        if (objectsPerChunk < 32)
+            objectsPerChunk = 32;
+
+        size_t alignment = (sizeClass.size % 16 == 0) ? 16 : 8;
+        sizeClass.pool = std::make_unique<PoolAllocator>(sizeClass.size, objectsPerChunk, alignment,
+            PoolGrowthPolicy{}, MemoryTag::SmallObject);
+    }
+
+    size_t classIndex = 0;
+    for (size_t entry = 0; entry < LookupEntries; ++entry)
+    {
+        size_t size = entry * Granularity;
+        while (g_classSizes[classIndex] < size)
+            ++classIndex;
+        m_lookup[entry] = static_cast<uint8_t>(classIndex);
+    }
+}
+
+void* SmallObjectAllocator::Allocate(size_t size)
+{
+    if (size > MaxSmallSize)
+    {
+        void* ptr = ::operator new(size, std::nothrow);
+        if (ptr)
+        {
+            MEM_TRACK_ALLOC(MemoryTag::SmallObject, size);
+            MEM_TRACE_ALLOC(MemoryTag::SmallObject, this, ptr, size, 0);
+        }
+        return ptr;
+    }
+
+    SizeClass& sizeClass = m_classes[m_lookup[(size + Granularity - 1) / Granularity]];
+    std::scoped_lock lock(sizeClass.mutex);
+    return sizeClass.pool->Allocate();
+}
+
+void SmallObjectAllocator::Free(void* ptr, size_t size)
+{
+    if (!ptr)
+        return;
+
+    if (size > MaxSmallSize)
+    {
+        MEM_TRACK_FREE(MemoryTag::SmallObject, size);
+        MEM_TRACE_FREE(MemoryTag::SmallObject, this, ptr);
+        ::operator delete(ptr);
+        return;
+    }
+
+    SizeClass& sizeClass = m_classes[m_lookup[(size + Granularity - 1) / Granularity]];
+    std::scoped_lock lock(sizeClass.mutex);
+    sizeClass.pool->Free(ptr);
+}
+
+void SmallObjectAllocator::Trim()
+{
+    for (SizeClass& sizeClass : m_classes)
+    {
+        std::scoped_lock lock(sizeClass.mutex);
+        sizeClass.pool->Trim();
+    }
+}
+
+void SmallObjectAllocator::GetStats(std::vector<SizeClassStats>& outStats) const
+{
+    outStats.clear();
+    outStats.reserve(ClassCount);
+    for (const SizeClass& sizeClass : m_classes)
+    {
+        SizeClassStats stats;
+        stats.classSize = sizeClass.size;
+        {
+            std::scoped_lock lock(sizeClass.mutex);
+            sizeClass.pool->GetStats(stats.pool);
+        }
+        outStats.push_back(stats);
+    }
+}
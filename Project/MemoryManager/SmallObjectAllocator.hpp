@@ -0,0 +1,82 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <vector>
+#include "PoolAllocator.hpp"
+
+struct SizeClassStats
+{
+    size_t classSize = 0;
+    PoolStats pool;
+};
+
+/*
+* Small object allocator with one growable pool per size class.
+* Requests up to MaxSmallSize bytes are mapped to their class through a lookup table,
+* anything bigger goes to the global heap. Free needs the size that was allocated.
+*/
+class SmallObjectAllocator
+{
+public:
+    static constexpr size_t MaxSmallSize = 512;
+    static constexpr size_t Granularity = 8;
+
+    static SmallObjectAllocator& Get();
+
+    void* Allocate(size_t size);
+    void Free(void* ptr, size_t size);
+
+    void Trim();
+    void GetStats(std::vector<SizeClassStats>& outStats) const;
+
+private:
+    SmallObjectAllocator();
+    ~SmallObjectAllocator() = default;
+
+    struct SizeClass
+    {
+        size_t size = 0;
+        std::unique_ptr<PoolAllocator> pool;
+        mutable std::mutex mutex;
+    };
+
+    static constexpr size_t ClassCount = 18;
+    static constexpr size_t LookupEntries = MaxSmallSize / Granularity + 1;
+
+    SizeClass m_classes[ClassCount];
+    uint8_t m_lookup[LookupEntries];    // (size + 7) / 8 -> class index
+};
+
+// STL allocator on top of the small object allocator, for node based containers and allocate_shared
+template<typename T>
+class SmallObjectStlAllocator
+{
+public:
+    using value_type = T;
+
+    SmallObjectStlAllocator() noexcept = default;
+    template<typename U>
+    SmallObjectStlAllocator(const SmallObjectStlAllocator<U>&) noexcept {}
+
+    T* allocate(size_t n)
+    {
+        static_assert(alignof(T) <= 16, "SmallObjectStlAllocator supports up to 16 byte alignment");
+        void* ptr = SmallObjectAllocator::Get().Allocate(n * sizeof(T));
+        if (!ptr)
+            throw std::bad_alloc();
+        return static_cast<T*>(ptr);
+    }
+
+    void deallocate(T* ptr, size_t n) noexcept
+    {
+        SmallObjectAllocator::Get().Free(ptr, n * sizeof(T));
+    }
+
+    template<typename U>
+    bool operator==(const SmallObjectStlAllocator<U>&) const noexcept { return true; }
+    template<typename U>
+    bool operator!=(const SmallObjectStlAllocator<U>&) const noexcept { return false; }
+};
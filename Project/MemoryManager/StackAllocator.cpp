@@ -1,44 +1,241 @@
 #include "StackAllocator.hpp"
+#include "MemoryTrace.hpp"
+#include <cstdlib>
 
-StackAllocator::StackAllocator(size_t capacity)
-    :m_capacity(capacity)
+static size_t AlignUp(size_t value, size_t alignment)
 {
-    m_base = static_cast<std::uint8_t*>(std::malloc(m_capacity));
-    m_offset = 0;
+    size_t rest = value % alignment;
+    if(rest == 0)
+        return value;
+
+    return value + (alignment - rest);
 }
 
-StackAllocator::~StackAllocator()
+StackAllocator::StackAllocator(size_t capacity, ArenaBacking backing, StackOverflowMode overflowMode)
+    :m_backing(backing), m_overflowMode(overflowMode)
 {
-    std::free(m_base);
-    m_base = nullptr;
-    m_capacity = 0;
+    CreatePrimary(capacity);
     m_offset = 0;
 }
 
-static size_t AlignUp(size_t value, size_t alignment)
+StackAllocator::~StackAllocator()
 {
-    size_t rest = value % alignment;
-    if(rest == 0)
-        return 0;
-
-    return value + (alignment - rest);
+    //Destroying the stack frees whatever is still on it, that is not a leak
+    TrackRewind(GetUsed(), 0);
+    ReleaseOverflowBlocks(0);
+    DestroyPrimary();
+    m_offset = 0;
 }
 
 void* StackAllocator::Allocate(size_t size, size_t alignment)
 {
+    //Once the frame spilled over, keep allocating from the chain so markers stay ordered
+    if (!m_overflowBlocks.empty())
+        return AllocateOverflow(size, alignment);
+
     size_t alignedOffset = AlignUp(m_offset, alignment);
     if(alignedOffset + size > m_capacity){
-        std::cout << "Error: Stack Allocator not enough capacity left" << std::endl;
+        if (m_overflowMode == StackOverflowMode::ChainBlocks)
+            return AllocateOverflow(size, alignment);
+
+        if (m_reportOutOfMemory)
+            std::cout << "Error: Stack Allocator not enough capacity left" << std::endl;
         return nullptr;
     }
 
+    if (alignedOffset + size > m_committed && !CommitUpTo(alignedOffset + size))
+        return nullptr;
+
     void* ptr = m_base + alignedOffset;
+    MEM_TRACK_ALLOC(MemoryTag::Stack, alignedOffset + size - m_offset);
+    MEM_TRACE_STACK_ALLOC(this, ptr, size, alignment, m_allocationCount);
     m_offset = alignedOffset + size;
+    ++m_allocationCount;
+    UpdatePeak();
 
     return ptr;
 }
 
 void StackAllocator::Reset()
 {
+    TrackRewind(GetUsed(), 0);
+    ReleaseOverflowBlocks(0);
+
+    if (m_overflowedThisFrame)
+    {
+        //The frame did not fit, grow the primary block to the observed peak so the next one does
+        DestroyPrimary();
+        CreatePrimary(AlignUp(m_peak, CommitGranularity));
+        m_overflowedThisFrame = false;
+    }
+    else if (m_backing == ArenaBacking::VirtualMemory)
+    {
+        //Keep what this frame needed, give everything above it back to the OS
+        size_t keep = AlignUp(m_offset, CommitGranularity);
+        if (keep > m_capacity)
+            keep = m_capacity;
+
+        if (keep < m_committed)
+        {
+            VirtualMemory::Decommit(m_base + keep, m_committed - keep);
+            m_committed = keep;
+        }
+    }
+
     m_offset = 0;
-}
\ No newline at end of file
+}
+
+StackMarker StackAllocator::GetMarker() const
+{
+    StackMarker marker;
+    marker.blockIndex = m_overflowBlocks.size();
+    marker.offset = m_overflowBlocks.empty() ? m_offset : m_overflowBlocks.back().offset;
+    marker.allocationCount = m_allocationCount;
+    return marker;
+}
+
+void StackAllocator::FreeToMarker(const StackMarker& marker)
+{
+    //A marker above the current top is stale (its scope was already released) and would move the top forward
+    size_t blockTop = 0;
+    if (marker.blockIndex <= m_overflowBlocks.size())
+        blockTop = marker.blockIndex == 0 ? m_offset : m_overflowBlocks[marker.blockIndex - 1].offset;
+    if (marker.blockIndex > m_overflowBlocks.size() || marker.offset > blockTop || marker.allocationCount > m_allocationCount)
+    {
+        std::cout << "Error: Stack Allocator marker is above the current top, stale or from a released scope" << std::endl;
+        return;
+    }
+
+    size_t usedBefore = GetUsed();
+    ReleaseOverflowBlocks(marker.blockIndex);
+
+    if (marker.blockIndex == 0)
+    {
+        m_offset = marker.offset;
+    }
+    else
+    {
+        OverflowBlock& block = m_overflowBlocks.back();
+        m_overflowUsed -= block.offset - marker.offset;
+        block.offset = marker.offset;
+    }
+
+    TrackRewind(usedBefore - GetUsed(), marker.allocationCount);
+}
+
+void* StackAllocator::AllocateOverflow(size_t size, size_t alignment)
+{
+    if (m_overflowBlocks.empty() || AlignUp(m_overflowBlocks.back().offset, alignment) + size > m_overflowBlocks.back().capacity)
+    {
+        size_t blockSize = m_capacity / 2 > CommitGranularity ? m_capacity / 2 : CommitGranularity;
+        if (blockSize < size + alignment)
+            blockSize = size + alignment;
+
+        OverflowBlock block;
+        block.base = static_cast<std::uint8_t*>(std::malloc(blockSize));
+        block.capacity = blockSize;
+        block.offset = 0;
+
+        if (!block.base)
+        {
+            if (m_reportOutOfMemory)
+                std::cout << "Error: Stack Allocator failed to chain an overflow block" << std::endl;
+            return nullptr;
+        }
+
+        m_overflowBlocks.push_back(block);
+        m_overflowedThisFrame = true;
+    }
+
+    OverflowBlock& block = m_overflowBlocks.back();
+
+    //Align the address, malloc only guarantees max_align_t
+    std::uintptr_t address = reinterpret_cast<std::uintptr_t>(block.base) + block.offset;
+    size_t padding = AlignUp(address, alignment) - address;
+
+    void* ptr = block.base + block.offset + padding;
+    block.offset += padding + size;
+    m_overflowUsed += padding + size;
+    MEM_TRACE_STACK_ALLOC(this, ptr, size, alignment, m_allocationCount);
+    ++m_allocationCount;
+    MEM_TRACK_ALLOC(MemoryTag::Stack, padding + size);
+    UpdatePeak();
+
+    return ptr;
+}
+
+void StackAllocator::ReleaseOverflowBlocks(size_t keepCount)
+{
+    while (m_overflowBlocks.size() > keepCount)
+    {
+        OverflowBlock& block = m_overflowBlocks.back();
+        m_overflowUsed -= block.offset;
+        std::free(block.base);
+        m_overflowBlocks.pop_back();
+    }
+}
+
+void StackAllocator::CreatePrimary(size_t capacity)
+{
+    m_capacity = capacity;
+
+    if (m_backing == ArenaBacking::VirtualMemory)
+    {
+        m_capacity = AlignUp(m_capacity, VirtualMemory::GetPageSize());
+        m_base = static_cast<std::uint8_t*>(VirtualMemory::Reserve(m_capacity));
+        m_committed = 0;
+    }
+    else
+    {
+        m_base = static_cast<std::uint8_t*>(std::malloc(m_capacity));
+        m_committed = m_capacity;
+    }
+
+    if (!m_base)
+    {
+        std::cout << "Error: Stack Allocator failed to allocate " << m_capacity << " bytes" << std::endl;
+        m_capacity = 0;
+        m_committed = 0;
+    }
+}
+
+void StackAllocator::DestroyPrimary()
+{
+    if (m_backing == ArenaBacking::VirtualMemory)
+        VirtualMemory::Release(m_base, m_capacity);
+    else
+        std::free(m_base);
+    m_base = nullptr;
+    m_capacity = 0;
+    m_committed = 0;
+}
+
+void StackAllocator::TrackRewind([[maybe_unused]] size_t bytes, size_t allocationCount)
+{
+    if (allocationCount > m_allocationCount)
+        allocationCount = m_allocationCount;
+
+    MEM_TRACK_FREE_N(MemoryTag::Stack, bytes, m_allocationCount - allocationCount);
+    MEM_TRACE_STACK_REWIND(this, allocationCount);
+    m_allocationCount = allocationCount;
+}
+
+void StackAllocator::UpdatePeak()
+{
+    size_t used = m_offset + m_overflowUsed;
+    if (used > m_peak)
+        m_peak = used;
+}
+
+bool StackAllocator::CommitUpTo(size_t offset)
+{
+    size_t target = AlignUp(offset, CommitGranularity);
+    if (target > m_capacity)
+        target = m_capacity;
+
+    if (!VirtualMemory::Commit(m_base + m_committed, target - m_committed))
+        return false;
+
+    m_committed = target;
+    return true;
+}
@@ -1,26 +1,99 @@
 #pragma once
 #include <iostream>
+#include <cstdint>
+#include <vector>
+#include "VirtualMemory.hpp"
+#include "MemoryTracking.hpp"
+
+enum class StackOverflowMode
+{
+    Fail,           // Allocate returns nullptr when the primary block is full
+    ChainBlocks     // chain extra heap blocks for the rest of the frame, Reset grows the primary block to the peak
+};
+
+// Position in the stack, blockIndex 0 is the primary block and 1.. the chained overflow blocks
+struct StackMarker
+{
+    size_t blockIndex = 0;
+    size_t offset = 0;
+    size_t allocationCount = 0;
+};
+
 class StackAllocator
 {
 public:
-    StackAllocator(size_t capacity);
+    // With ArenaBacking::VirtualMemory the capacity is only reserved, pages are committed as the offset grows
+    StackAllocator(size_t capacity, ArenaBacking backing = ArenaBacking::Heap, StackOverflowMode overflowMode = StackOverflowMode::Fail);
     ~StackAllocator();
 
+    StackAllocator(const StackAllocator&) = delete;
+    StackAllocator& operator=(const StackAllocator&) = delete;
+
     void* Allocate(size_t size, size_t alignment = alignof(::max_align_t));
     void Reset();
 
-    size_t GetUsed() const { return m_offset; }
+    StackMarker GetMarker() const;
+    void FreeToMarker(const StackMarker& marker);
+
+    size_t GetUsed() const { return m_offset + m_overflowUsed; }
     size_t GetCapacity() const { return m_capacity; }
+    size_t GetCommitted() const { return m_committed; }
+    size_t GetPeak() const { return m_peak; }
+    size_t GetOverflowBlockCount() const { return m_overflowBlocks.size(); }
+    // Off when a wrapper reports failed allocations itself
+    void SetReportOutOfMemory(bool report) { m_reportOutOfMemory = report; }
     float GetUsageRatio() const
     {
         if(m_capacity == 0) return 0.0f;
-        return static_cast<float>(m_offset) / static_cast<float>(m_capacity);
+        return static_cast<float>(GetUsed()) / static_cast<float>(m_capacity);
     }
 
 private:
+    struct OverflowBlock
+    {
+        std::uint8_t* base;
+        size_t capacity;
+        size_t offset;
+    };
+
+    bool CommitUpTo(size_t offset);
+    void* AllocateOverflow(size_t size, size_t alignment);
+    void ReleaseOverflowBlocks(size_t keepCount);
+    void CreatePrimary(size_t capacity);
+    void DestroyPrimary();
+    void UpdatePeak();
+    void TrackRewind(size_t usedBefore, size_t allocationCount);
+
     std::uint8_t* m_base;
     size_t m_capacity;
     size_t m_offset;
+    ArenaBacking m_backing;
+    StackOverflowMode m_overflowMode;
+    size_t m_committed;
+
+    std::vector<OverflowBlock> m_overflowBlocks;
+    size_t m_overflowUsed = 0;
+    size_t m_allocationCount = 0;
+    bool m_overflowedThisFrame = false;
 
     size_t m_peak = 0;
-};
\ No newline at end of file
+    bool m_reportOutOfMemory = true;
+
+    static constexpr size_t CommitGranularity = 64 * 1024;
+};
+
+// Frees everything allocated inside the scope when it ends
+class StackScope
+{
+public:
+    explicit StackScope(StackAllocator& allocator)
+        : m_allocator(allocator), m_marker(allocator.GetMarker()) {}
+    ~StackScope() { m_allocator.FreeToMarker(m_marker); }
+
+    StackScope(const StackScope&) = delete;
+    StackScope& operator=(const StackScope&) = delete;
+
+private:
+    StackAllocator& m_allocator;
+    StackMarker m_marker;
+};
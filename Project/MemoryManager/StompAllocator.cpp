@@ -1,4 +1,12 @@
 #include "StompAllocator.hpp"
+#include "MemoryTrace.hpp"
+#include "VirtualMemory.hpp"
+#include "BitUtils.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <new>
 #ifdef _WIN32
 #include <Windows.h>
 #elif defined(__linux__)
@@ -6,7 +14,8 @@
 #include <sys/mman.h>
 #endif
 //#define StompDebug
-StompAllocator::StompAllocator()
+StompAllocator::StompAllocator(StompMode mode, const StompRegionConfig& config)
+	: m_mode(mode), m_config(config)
 {
 #if defined(_WIN32 )
 	SYSTEM_INFO si;
@@ -14,16 +23,58 @@ StompAllocator::StompAllocator()
 	m_pageSize = si.dwPageSize;
 #elif defined(__linux__)
 	m_pageSize = sysconf(_SC_PAGESIZE);
-	printf("%li", m_pageSize);
 #endif
+#ifdef StompDebug
+	std::cout << "page size: " << m_pageSize << "\n";
+#endif
+
+	if (m_mode == StompMode::SlotRegion)
+	{
+		m_config.regionSize = (m_config.regionSize + m_pageSize - 1) / m_pageSize * m_pageSize;
+		m_regionBase = static_cast<char*>(VirtualMemory::Reserve(m_config.regionSize));
+		if (!m_regionBase)
+			throw std::bad_alloc();
+
+		//One mapping for the whole region, everything no-access until a slot is handed out.
+		//Faulting a page first gives the mapping its anonymous memory descriptor before it is split,
+		//so closed slots share it and merge back with their neighbours on Linux
+		VirtualMemory::Commit(m_regionBase, m_pageSize);
+		m_regionBase[0] = 0;
+		closePages(m_regionBase, m_config.regionSize);
+		m_freeSlots.resize(classIndex(m_config.regionSize / m_pageSize) + 1);
+		if (m_config.protectBatch == 0)
+			m_config.protectBatch = 1;
+
+		//Every open slot splits the region mapping around itself, Linux caps the mappings per process
+		if (m_config.maxLiveSlots == 0)
+		{
+			m_config.maxLiveSlots = SIZE_MAX;
+#if defined(__linux__)
+			size_t maxMapCount = 65530;
+			std::ifstream("/proc/sys/vm/max_map_count") >> maxMapCount;
+			m_config.maxLiveSlots = maxMapCount / 4;
+#endif
+		}
+	}
 }
 
 StompAllocator::~StompAllocator()
 {
+	if (m_regionBase)
+		VirtualMemory::Release(m_regionBase, m_config.regionSize);
 }
 
-void* StompAllocator::allocate(size_t size)
+void* StompAllocator::allocate(size_t size, size_t alignment)
 {
+	if (m_mode == StompMode::SlotRegion)
+		return allocateSlot(size, alignment);
+
+	if (alignment > m_pageSize)
+	{
+		std::cout << "ERROR: stomp allocator: alignment " << alignment << " larger than a page\n";
+		return nullptr;
+	}
+
 
 	size_t required_pages = (size + m_pageSize - 1) / m_pageSize; //roof division
 	size_t total_pages = 1 + required_pages + 1; //header page + user page + guard page
@@ -34,7 +85,8 @@ void* StompAllocator::allocate(size_t size)
 
 	if (!base)
 	{
-		std::cout << "ERROR: Stomp allocation : virtual alloc fail" << std::endl;
+		if (m_reportOutOfMemory)
+			std::cout << "ERROR: Stomp allocation : virtual alloc fail" << std::endl;
 		return nullptr;
 	}
 
@@ -48,7 +100,8 @@ void* StompAllocator::allocate(size_t size)
 	
 	if (!VirtualProtect(guard_page, m_pageSize, PAGE_NOACCESS, &oldprotect))
 	{
-		std::cout << "ERROR: Stomp allocation : guard allocation" << std::endl;
+		if (m_reportOutOfMemory)
+			std::cout << "ERROR: Stomp allocation : guard allocation" << std::endl;
 		VirtualFree(base, 0, MEM_RELEASE);
 		return nullptr;
 	}
@@ -61,7 +114,8 @@ void* StompAllocator::allocate(size_t size)
 
 	if (!VirtualProtect(header_page, m_pageSize, PAGE_READONLY, &oldprotect))
 	{
-		std::cout << "ERROR: Stomp allocation : protecting header page" << std::endl;
+		if (m_reportOutOfMemory)
+			std::cout << "ERROR: Stomp allocation : protecting header page" << std::endl;
 		VirtualFree(base, 0, MEM_RELEASE);
 		return nullptr;
 	}
@@ -73,7 +127,8 @@ void* StompAllocator::allocate(size_t size)
 		-1, 0);
 
 	if (base == MAP_FAILED) {
-		std::cout << "ERROR: mmap failed\n";
+		if (m_reportOutOfMemory)
+			std::cout << "ERROR: mmap failed\n";
 		return nullptr;
 	}
 
@@ -83,7 +138,8 @@ void* StompAllocator::allocate(size_t size)
 	void* guard_page = (char*)base + (total_pages - 1) * m_pageSize; // allign the guard pointer to the end
 	
 	if (mprotect(guard_page, m_pageSize, PROT_NONE) != 0) {
-		std::cout << "ERROR: mprotect guard failed\n";
+		if (m_reportOutOfMemory)
+			std::cout << "ERROR: mprotect guard failed\n";
 		munmap(base, total_bytes);
 		return nullptr;
 	}
@@ -95,12 +151,16 @@ void* StompAllocator::allocate(size_t size)
 
 	// Protect header page as READONLY
 	if (mprotect(header_page, m_pageSize, PROT_READ) != 0) {
-		std::cout << "ERROR: mprotect header failed\n";
+		if (m_reportOutOfMemory)
+			std::cout << "ERROR: mprotect header failed\n";
 		munmap(base, total_bytes);
 		return nullptr;
 	}
 #endif
 
+	MEM_TRACK_ALLOC(MemoryTag::Stomp, size);
+	MEM_TRACE_ALLOC(MemoryTag::Stomp, this, user_ptr, size, 0);
+
 #ifdef StompDebug
 	std::cout << "base:        " << base << "\n";
 	std::cout << "user_ptr:    " << (void*)user_ptr << "\n";
@@ -113,11 +173,34 @@ void* StompAllocator::allocate(size_t size)
 	return user_ptr;
 }
 
+size_t StompAllocator::allocationSize(void* ptr)
+{
+	if (!ptr)
+		return 0;
+
+	if (m_mode == StompMode::SlotRegion)
+	{
+		std::scoped_lock lock(m_mutex);
+		auto it = m_liveSlots.find(ptr);
+		return it != m_liveSlots.end() ? it->second.requested_size : 0;
+	}
+
+	AllocationInfo* header = (AllocationInfo*)((char*)ptr - m_pageSize);
+	return header->requested_size;
+}
+
 void StompAllocator::deallocate(void* ptr)
 {
+	if (m_mode == StompMode::SlotRegion)
+	{
+		deallocateSlot(ptr);
+		return;
+	}
+
 	if (!ptr)
 	{
 		std::cout << "ERROR: stomp allocator: deallocate ptr not found\n";
+		return;
 	}
 	char* header_page = (char*)ptr - m_pageSize;
 
@@ -125,6 +208,8 @@ void StompAllocator::deallocate(void* ptr)
 	void* base = header->baseAddress;
 	size_t total_pages = header->allocated_pages;
 	size_t total_bytes = total_pages * m_pageSize;
+	MEM_TRACK_FREE(MemoryTag::Stomp, header->requested_size);
+	MEM_TRACE_FREE(MemoryTag::Stomp, this, ptr);
 
 #if defined(_WIN32)
 
@@ -136,4 +221,195 @@ void StompAllocator::deallocate(void* ptr)
 	
 }
 
+void StompAllocator::flush()
+{
+	if (m_mode != StompMode::SlotRegion)
+		return;
+
+	std::scoped_lock lock(m_mutex);
+	flushLocked();
+}
+
+void* StompAllocator::allocateSlot(size_t size, size_t alignment)
+{
+	if (size == 0)
+		size = 1;
+	if (alignment == 0 || (alignment & (alignment - 1)) != 0 || alignment > m_pageSize)
+	{
+		std::cout << "ERROR: stomp allocator: bad alignment " << alignment << "\n";
+		return nullptr;
+	}
+
+	size_t pages = classPages((size + m_pageSize - 1) / m_pageSize);
+	size_t slotBytes = pages * m_pageSize;
+	if (slotBytes + m_pageSize > m_config.regionSize)
+	{
+		if (m_reportOutOfMemory)
+			std::cout << "ERROR: stomp allocator: " << size << " bytes does not fit the slot region\n";
+		return nullptr;
+	}
+
+	std::scoped_lock lock(m_mutex);
+
+	//Pending frees are still open pages, protecting them lets their mappings merge back
+	if (m_liveSlots.size() + m_pendingFrees.size() >= m_config.maxLiveSlots)
+		flushLocked();
+	if (m_liveSlots.size() >= m_config.maxLiveSlots)
+	{
+		if (m_reportOutOfMemory)
+			std::cout << "ERROR: stomp allocator: " << m_liveSlots.size() << " live slots, limit reached\n";
+		return nullptr;
+	}
+
+	size_t offset;
+	std::vector<size_t>& freeList = m_freeSlots[classIndex(pages)];
+	if (!freeList.empty())
+	{
+		offset = freeList.back();
+		freeList.pop_back();
+	}
+	else
+	{
+		//New slot plus its guard page, the guard is already no-access
+		if (m_regionUsed + slotBytes + m_pageSize > m_config.regionSize)
+		{
+			if (m_reportOutOfMemory)
+				std::cout << "ERROR: stomp allocator: slot region exhausted\n";
+			return nullptr;
+		}
+		offset = m_regionUsed;
+		m_regionUsed += slotBytes + m_pageSize;
+	}
+
+	char* slot = m_regionBase + offset;
+	if (!openPages(slot, slotBytes))
+	{
+		if (m_reportOutOfMemory)
+			std::cout << "ERROR: stomp allocator: could not open slot\n";
+		freeList.push_back(offset);
+		return nullptr;
+	}
+
+	//Right-aligned, the alignment padding behind the block is filled and checked on free
+	char* slotEnd = slot + slotBytes;
+	char* user_ptr = reinterpret_cast<char*>(reinterpret_cast<uintptr_t>(slotEnd - size) & ~(uintptr_t(alignment) - 1));
+	memset(user_ptr + size, TailFill, slotEnd - (user_ptr + size));
+	m_liveSlots[user_ptr] = SlotInfo{ offset, pages, size };
+
+	MEM_TRACK_ALLOC(MemoryTag::Stomp, size);
+	MEM_TRACE_ALLOC(MemoryTag::Stomp, this, user_ptr, size, 0);
+	return user_ptr;
+}
+
+void StompAllocator::deallocateSlot(void* ptr)
+{
+	if (!ptr)
+		return;
+
+	std::scoped_lock lock(m_mutex);
+	auto it = m_liveSlots.find(ptr);
+	if (it == m_liveSlots.end())
+	{
+		char* p = static_cast<char*>(ptr);
+		if (p >= m_regionBase && p < m_regionBase + m_config.regionSize)
+			std::cout << "ERROR: stomp allocator: double free or interior pointer " << ptr << "\n";
+		else
+			std::cout << "ERROR: stomp allocator: deallocate ptr not found\n";
+		return;
+	}
+
+	const char* tail = static_cast<char*>(ptr) + it->second.requested_size;
+	const char* slotEnd = m_regionBase + it->second.offset + it->second.pages * m_pageSize;
+	for (const char* p = slotEnd; p-- > tail;)
+	{
+		//Overflows past the padding already faulted on the guard page
+		if (static_cast<unsigned char>(*p) != TailFill)
+		{
+			std::cout << "ERROR: stomp allocator: " << (p - tail + 1) << " byte overflow past " << ptr << " detected on free\n";
+			break;
+		}
+	}
+
+	MEM_TRACK_FREE(MemoryTag::Stomp, it->second.requested_size);
+	MEM_TRACE_FREE(MemoryTag::Stomp, this, ptr);
+
+	m_pendingFrees.push_back(it->second);
+	m_liveSlots.erase(it);
+
+	if (m_pendingFrees.size() >= m_config.protectBatch)
+		flushLocked();
+}
+
+void StompAllocator::flushLocked()
+{
+	if (m_pendingFrees.empty())
+		return;
+
+	//Neighbouring slots share no-access guards, so address sorted runs collapse into one call
+	std::sort(m_pendingFrees.begin(), m_pendingFrees.end(),
+		[](const SlotInfo& a, const SlotInfo& b) { return a.offset < b.offset; });
+
+	size_t runStart = m_pendingFrees[0].offset;
+	size_t runEnd = runStart;
+	for (const SlotInfo& slot : m_pendingFrees)
+	{
+		if (slot.offset != runEnd)
+		{
+			closePages(m_regionBase + runStart, runEnd - runStart);
+			runStart = slot.offset;
+		}
+		runEnd = slot.offset + (slot.pages + 1) * m_pageSize;
+	}
+	closePages(m_regionBase + runStart, runEnd - runStart);
+
+	for (const SlotInfo& slot : m_pendingFrees)
+	{
+		m_quarantine.push_back(slot);
+		m_quarantinedBytes += slot.pages * m_pageSize;
+	}
+	m_pendingFrees.clear();
+
+	//Only the oldest quarantined slots become reusable
+	while (m_quarantinedBytes > m_config.quarantineBytes && !m_quarantine.empty())
+	{
+		const SlotInfo& oldest = m_quarantine.front();
+		m_freeSlots[classIndex(oldest.pages)].push_back(oldest.offset);
+		m_quarantinedBytes -= oldest.pages * m_pageSize;
+		m_quarantine.pop_front();
+	}
+}
+
+size_t StompAllocator::classPages(size_t pages) const
+{
+	//Exact sizes for small blocks, powers of two above that
+	if (pages <= 16)
+		return pages ? pages : 1;
+	return size_t(1) << CeilLog2(pages);
+}
+
+size_t StompAllocator::classIndex(size_t pages) const
+{
+	if (pages <= 16)
+		return pages ? pages - 1 : 0;
+	return 16 + CeilLog2(pages) - 5;
+}
+
+bool StompAllocator::openPages(char* ptr, size_t size)
+{
+#if defined(_WIN32)
+	return VirtualMemory::Commit(ptr, size);
+#else
+	return VirtualMemory::Protect(ptr, size, true);
+#endif
+}
 
+void StompAllocator::closePages(char* ptr, size_t size)
+{
+	//Decommitted pages fault on access on Windows, Linux needs the protection change as well
+#if defined(_WIN32)
+	VirtualMemory::Decommit(ptr, size);
+#else
+	VirtualMemory::Protect(ptr, size, false);
+	VirtualMemory::Decommit(ptr, size);
+#endif
+}
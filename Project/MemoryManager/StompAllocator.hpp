@@ -1,21 +1,51 @@
 #pragma once
 #include <iostream>
+#include <cstddef>
 #include <vector>
+#include <deque>
+#include <mutex>
+#include <unordered_map>
 #include <functional>
+#include "MemoryTracking.hpp"
 
+enum class StompMode
+{
+	PerAllocation,	// every block is its own mapping: read-only header page, data pages, guard page
+	SlotRegion		// blocks are carved from one reserved region and recycled, freed slots are protected in batches
+};
+
+struct StompRegionConfig
+{
+	size_t regionSize = size_t(1) << 30;		// reserved address space, only touched pages cost memory
+	size_t quarantineBytes = 32 * 1024 * 1024;	// freed slots stay no-access until this much is quarantined
+	size_t protectBatch = 32;					// frees collected before they are protected together, 1 = protect every free
+	size_t maxLiveSlots = 0;					// live plus pending slots, 0 = a quarter of vm.max_map_count on Linux, unlimited elsewhere
+};
 
 class StompAllocator
 {
 public:
-	StompAllocator();
+	StompAllocator(StompMode mode = StompMode::PerAllocation, const StompRegionConfig& config = {});
 	~StompAllocator();
 
-	void* allocate(size_t size);
+	StompAllocator(const StompAllocator&) = delete;
+	StompAllocator& operator=(const StompAllocator&) = delete;
+
+	//Slot region blocks end exactly on the guard page when alignment is 1, otherwise the bytes between
+	//the block and the guard are checked on free
+	void* allocate(size_t size, size_t alignment = alignof(std::max_align_t));
 	void deallocate(void* ptr);
+	//Requested size of a live block, 0 if ptr is not one
+	size_t allocationSize(void* ptr);
+	//Protects every pending free now (slot region only), use before checking for use-after-free
+	void flush();
+	//Off when a wrapper reports failed allocations itself
+	void setReportOutOfMemory(bool report) { m_reportOutOfMemory = report; }
 	//bool accessViolation(std::function<void()> test);
 
 private:
 	size_t m_pageSize;
+	StompMode m_mode;
 
 	struct AllocationInfo
 	{
@@ -24,4 +54,34 @@ private:
 		void* baseAddress;   // The base returned by VirtualAlloc
 	};
 
+	//Slot region: [data pages][guard page], the block is right-aligned against the guard
+	struct SlotInfo
+	{
+		size_t offset;		// first data page, from the region base
+		size_t pages;		// data pages, without the guard
+		size_t requested_size;
+	};
+
+	//Written between the end of a slot block and its guard page
+	static constexpr unsigned char TailFill = 0xFD;
+
+	void* allocateSlot(size_t size, size_t alignment);
+	void deallocateSlot(void* ptr);
+	void flushLocked();
+	size_t classIndex(size_t pages) const;
+	size_t classPages(size_t pages) const;
+
+	bool openPages(char* ptr, size_t size);
+	void closePages(char* ptr, size_t size);
+
+	StompRegionConfig m_config;
+	char* m_regionBase = nullptr;
+	size_t m_regionUsed = 0;		// bump offset, slots below it exist
+	std::mutex m_mutex;
+	std::unordered_map<void*, SlotInfo> m_liveSlots;
+	std::vector<std::vector<size_t>> m_freeSlots;	// per size class, offsets of protected reusable slots
+	std::vector<SlotInfo> m_pendingFrees;			// freed but still accessible until the next flush
+	std::deque<SlotInfo> m_quarantine;				// protected, oldest first
+	size_t m_quarantinedBytes = 0;
+	bool m_reportOutOfMemory = true;
 };
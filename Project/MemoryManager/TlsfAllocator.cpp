@@ -0,0 +1,246 @@
+#include "TlsfAllocator.hpp"
+#include "BitUtils.hpp"
+#include "MemoryTrace.hpp"
+#include <cstdlib>
+#include <new>
+
+TlsfAllocator::TlsfAllocator(size_t totalSize, ArenaBacking backing)
+	: m_backing(backing)
+{
+	//Room for one minimum block plus the end sentinel
+	m_totalSize = totalSize & ~(Alignment - 1);
+	if (m_totalSize < 2 * HeaderSize + MinBlockSize)
+		throw std::bad_alloc();
+
+	if (m_backing == ArenaBacking::VirtualMemory)
+	{
+		//Headers are spread over the whole arena, so it is committed up front and the OS backs pages on first touch
+		m_basePtr = static_cast<char*>(VirtualMemory::Reserve(m_totalSize));
+		if (m_basePtr && !VirtualMemory::Commit(m_basePtr, m_totalSize))
+		{
+			VirtualMemory::Release(m_basePtr, m_totalSize);
+			m_basePtr = nullptr;
+		}
+	}
+	else
+	{
+		m_basePtr = static_cast<char*>(malloc(m_totalSize));
+	}
+	if (!m_basePtr)
+		throw std::bad_alloc();
+
+	//One free block over the arena, followed by a zero sized used sentinel that stops merging
+	BlockHeader* first = reinterpret_cast<BlockHeader*>(m_basePtr);
+	first->prevPhysical = nullptr;
+	first->sizeAndFlags = m_totalSize - 2 * HeaderSize;
+
+	BlockHeader* sentinel = NextPhysical(first);
+	sentinel->sizeAndFlags = 0;
+
+	MarkFree(first);
+	InsertFree(first);
+
+	//Requests are rounded up to the next bin, only sizes at the start of the arena block's bin can still find it
+	size_t maxBlockSize = BlockSize(first);
+	if (maxBlockSize >= SmallBlockSize)
+	{
+		uint32_t binShift = FindLastSet(maxBlockSize) - SlShift;
+		maxBlockSize = (maxBlockSize >> binShift) << binShift;
+	}
+	size_t largestMapped = size_t(1) << FlMaxShift;
+	m_maxBlockSize = maxBlockSize < largestMapped ? maxBlockSize : largestMapped;
+}
+
+TlsfAllocator::~TlsfAllocator()
+{
+	if (m_backing == ArenaBacking::VirtualMemory)
+		VirtualMemory::Release(m_basePtr, m_totalSize);
+	else
+		free(m_basePtr);
+}
+
+void* TlsfAllocator::Allocate(size_t size)
+{
+	if (size > m_maxBlockSize) return nullptr;
+
+	size_t adjusted = (size + Alignment - 1) & ~(Alignment - 1);
+	if (adjusted < MinBlockSize)
+		adjusted = MinBlockSize;
+
+	uint32_t fl, sl;
+	MappingSearch(adjusted, fl, sl);
+	BlockHeader* block = fl < FlCount ? FindSuitable(fl, sl) : nullptr;
+	if (!block)
+	{
+		//no more memory to give :(
+		return nullptr;
+	}
+	RemoveFree(block, fl, sl);
+
+	//Split off the tail when it can hold a block of its own
+	size_t blockSize = BlockSize(block);
+	if (blockSize >= adjusted + HeaderSize + MinBlockSize)
+	{
+		SetSize(block, adjusted);
+
+		BlockHeader* rest = NextPhysical(block);
+		rest->sizeAndFlags = blockSize - adjusted - HeaderSize;
+		MarkFree(rest);
+		InsertFree(rest);
+	}
+	MarkUsed(block);
+
+	m_allocatedBytes += BlockSize(block);
+	++m_allocationCount;
+	MEM_TRACK_ALLOC(MemoryTag::Tlsf, BlockSize(block));
+	MEM_TRACE_ALLOC(MemoryTag::Tlsf, this, ToUser(block), size, 0);
+	return ToUser(block);
+}
+
+void TlsfAllocator::Deallocate(void* ptr)
+{
+	if (!ptr) return;
+
+	const char* p = static_cast<const char*>(ptr);
+	if (p < m_basePtr + HeaderSize || p >= m_basePtr + m_totalSize)
+	{
+		std::cout << "[Tlsf] ERROR: pointer does not belong to this allocator\n";
+		return;
+	}
+
+	BlockHeader* block = FromUser(ptr);
+	if (IsFree(block))
+	{
+		std::cout << "[Tlsf] ERROR: double free detected\n";
+		return;
+	}
+
+	m_allocatedBytes -= BlockSize(block);
+	--m_allocationCount;
+	MEM_TRACK_FREE(MemoryTag::Tlsf, BlockSize(block));
+	MEM_TRACE_FREE(MemoryTag::Tlsf, this, ptr);
+
+	MarkFree(block);
+	InsertFree(MergeNeighbours(block));
+}
+
+size_t TlsfAllocator::GetUsableSize(const void* ptr) const
+{
+	return ptr ? BlockSize(FromUser(ptr)) : 0;
+}
+
+void TlsfAllocator::MarkFree(BlockHeader* block)
+{
+	block->sizeAndFlags |= FreeBit;
+	BlockHeader* next = NextPhysical(block);
+	next->prevPhysical = block;
+	next->sizeAndFlags |= PrevFreeBit;
+}
+
+void TlsfAllocator::MarkUsed(BlockHeader* block)
+{
+	block->sizeAndFlags &= ~FreeBit;
+	NextPhysical(block)->sizeAndFlags &= ~PrevFreeBit;
+}
+
+void TlsfAllocator::MappingInsert(size_t size, uint32_t& outFl, uint32_t& outSl)
+{
+	if (size < SmallBlockSize)
+	{
+		//Small blocks are spread linearly over the second level of level 0
+		outFl = 0;
+		outSl = static_cast<uint32_t>(size >> AlignShift);
+		return;
+	}
+
+	uint32_t shift = FindLastSet(size);
+	outSl = static_cast<uint32_t>(size >> (shift - SlShift)) ^ SlCount;
+	outFl = shift - FlShift + 1;
+}
+
+void TlsfAllocator::MappingSearch(size_t size, uint32_t& outFl, uint32_t& outSl)
+{
+	//Round up to the next bin so any block found there is big enough
+	if (size >= SmallBlockSize)
+		size += (size_t(1) << (FindLastSet(size) - SlShift)) - 1;
+	MappingInsert(size, outFl, outSl);
+}
+
+TlsfAllocator::BlockHeader* TlsfAllocator::FindSuitable(uint32_t& fl, uint32_t& sl) const
+{
+	uint32_t slMap = m_slBitmap[fl] & (~0u << sl);
+	if (slMap == 0)
+	{
+		//Nothing left in this power of two, take the smallest non-empty one above it
+		uint32_t flMap = fl + 1 < 32 ? m_flBitmap & (~0u << (fl + 1)) : 0;
+		if (flMap == 0)
+			return nullptr;
+
+		fl = FindFirstSet(flMap);
+		slMap = m_slBitmap[fl];
+	}
+	sl = FindFirstSet(slMap);
+	return m_freeLists[fl][sl];
+}
+
+void TlsfAllocator::InsertFree(BlockHeader* block)
+{
+	uint32_t fl, sl;
+	MappingInsert(BlockSize(block), fl, sl);
+
+	BlockHeader* head = m_freeLists[fl][sl];
+	block->prevFree = nullptr;
+	block->nextFree = head;
+	if (head)
+		head->prevFree = block;
+	m_freeLists[fl][sl] = block;
+
+	m_flBitmap |= 1u << fl;
+	m_slBitmap[fl] |= 1u << sl;
+}
+
+void TlsfAllocator::RemoveFree(BlockHeader* block, uint32_t fl, uint32_t sl)
+{
+	if (block->prevFree)
+		block->prevFree->nextFree = block->nextFree;
+	else
+		m_freeLists[fl][sl] = block->nextFree;
+	if (block->nextFree)
+		block->nextFree->prevFree = block->prevFree;
+
+	if (!m_freeLists[fl][sl])
+	{
+		m_slBitmap[fl] &= ~(1u << sl);
+		if (m_slBitmap[fl] == 0)
+			m_flBitmap &= ~(1u << fl);
+	}
+}
+
+void TlsfAllocator::RemoveFree(BlockHeader* block)
+{
+	uint32_t fl, sl;
+	MappingInsert(BlockSize(block), fl, sl);
+	RemoveFree(block, fl, sl);
+}
+
+TlsfAllocator::BlockHeader* TlsfAllocator::MergeNeighbours(BlockHeader* block)
+{
+	//The sentinel is never free and the first block never has a free predecessor, so both ends stop here
+	if (IsPrevFree(block))
+	{
+		BlockHeader* prev = block->prevPhysical;
+		RemoveFree(prev);
+		SetSize(prev, BlockSize(prev) + HeaderSize + BlockSize(block));
+		block = prev;
+		NextPhysical(block)->prevPhysical = block;
+	}
+
+	BlockHeader* next = NextPhysical(block);
+	if (IsFree(next))
+	{
+		RemoveFree(next);
+		SetSize(block, BlockSize(block) + HeaderSize + BlockSize(next));
+		NextPhysical(block)->prevPhysical = block;
+	}
+	return block;
+}
@@ -0,0 +1,90 @@
+#pragma once
+#include <iostream>
+#include <cstdint>
+#include "VirtualMemory.hpp"
+#include "MemoryTracking.hpp"
+
+/*
+* Two-Level Segregated Fit allocator.
+* Free blocks are binned by size: the first level is the power of two, the second level splits
+* each power of two into SlCount linear ranges. Two bitmaps find a non-empty bin with a bit scan,
+* so Allocate and Deallocate are O(1) and never walk a list. Blocks keep their exact (16 byte rounded)
+* size and are merged with their physical neighbours on free, which makes it a much better fit than
+* Buddy for odd sized payloads such as texture data.
+* Every block has a 16 byte header (previous physical block + size), user pointers are 16 byte aligned.
+*/
+class TlsfAllocator
+{
+public:
+	TlsfAllocator(size_t totalSize, ArenaBacking backing = ArenaBacking::Heap);
+	~TlsfAllocator();
+
+	TlsfAllocator(const TlsfAllocator&) = delete;
+	TlsfAllocator& operator=(const TlsfAllocator&) = delete;
+
+	void* Allocate(size_t size);
+	void Deallocate(void* ptr);
+
+	size_t GetUsableSize(const void* ptr) const;
+	size_t GetTotalSize() const { return m_totalSize; }
+	size_t GetAllocatedBytes() const { return m_allocatedBytes; }	//sum of handed out block sizes, without headers
+	size_t GetAllocationCount() const { return m_allocationCount; }
+	size_t GetMaxAllocationSize() const { return m_maxBlockSize; }
+
+private:
+	struct BlockHeader
+	{
+		BlockHeader* prevPhysical;	//only valid while the previous block is free
+		size_t sizeAndFlags;		//payload size, low bits are the flags below
+		//Only valid while the block is free, they live in the payload
+		BlockHeader* nextFree;
+		BlockHeader* prevFree;
+	};
+
+	static constexpr uint32_t AlignShift = 4;
+	static constexpr size_t Alignment = size_t(1) << AlignShift;
+	static constexpr size_t HeaderSize = 16;						//prevPhysical + sizeAndFlags, the user pointer follows
+	static constexpr size_t MinBlockSize = sizeof(BlockHeader) - HeaderSize;
+	static constexpr uint32_t SlShift = 5;
+	static constexpr uint32_t SlCount = 1u << SlShift;
+	static constexpr uint32_t FlShift = SlShift + AlignShift;		//sizes below 1 << FlShift all go to first level 0
+	static constexpr uint32_t FlMaxShift = 38;						//256 GB
+	static constexpr uint32_t FlCount = FlMaxShift - FlShift + 2;	//+1 for the small block level
+	static constexpr size_t SmallBlockSize = size_t(1) << FlShift;
+
+	static constexpr size_t FreeBit = 1;
+	static constexpr size_t PrevFreeBit = 2;
+	static constexpr size_t FlagMask = FreeBit | PrevFreeBit;
+
+	size_t m_totalSize;
+	char* m_basePtr;
+	ArenaBacking m_backing;
+	size_t m_maxBlockSize;
+
+	uint32_t m_flBitmap = 0;
+	uint32_t m_slBitmap[FlCount] = {};
+	BlockHeader* m_freeLists[FlCount][SlCount] = {};
+
+	size_t m_allocatedBytes = 0;
+	size_t m_allocationCount = 0;
+
+	static size_t BlockSize(const BlockHeader* block) { return block->sizeAndFlags & ~FlagMask; }
+	static bool IsFree(const BlockHeader* block) { return (block->sizeAndFlags & FreeBit) != 0; }
+	static bool IsPrevFree(const BlockHeader* block) { return (block->sizeAndFlags & PrevFreeBit) != 0; }
+	static void SetSize(BlockHeader* block, size_t size) { block->sizeAndFlags = size | (block->sizeAndFlags & FlagMask); }
+	static void MarkFree(BlockHeader* block);	//also tells the next block its neighbour is free
+	static void MarkUsed(BlockHeader* block);
+
+	static BlockHeader* NextPhysical(BlockHeader* block) { return reinterpret_cast<BlockHeader*>(reinterpret_cast<char*>(block) + HeaderSize + BlockSize(block)); }
+	static void* ToUser(BlockHeader* block) { return reinterpret_cast<char*>(block) + HeaderSize; }
+	static BlockHeader* FromUser(const void* ptr) { return reinterpret_cast<BlockHeader*>(const_cast<char*>(static_cast<const char*>(ptr)) - HeaderSize); }
+
+	static void MappingInsert(size_t size, uint32_t& outFl, uint32_t& outSl);
+	static void MappingSearch(size_t size, uint32_t& outFl, uint32_t& outSl);
+	BlockHeader* FindSuitable(uint32_t& fl, uint32_t& sl) const;
+
+	void InsertFree(BlockHeader* block);
+	void RemoveFree(BlockHeader* block, uint32_t fl, uint32_t sl);
+	void RemoveFree(BlockHeader* block);
+	BlockHeader* MergeNeighbours(BlockHeader* block);
+};
@@ -0,0 +1,101 @@
+#include "VirtualMemory.hpp"
+#include <iostream>
+#ifdef _WIN32
+#include <Windows.h>
+#elif defined(__linux__)
+#include <unistd.h>
+#include <sys/mman.h>
+#endif
+
+size_t VirtualMemory::GetPageSize()
+{
+	static size_t pageSize = []()
+	{
+#if defined(_WIN32)
+		SYSTEM_INFO si;
+		GetSystemInfo(&si);
+		return static_cast<size_t>(si.dwPageSize);
+#elif defined(__linux__)
+		return static_cast<size_t>(sysconf(_SC_PAGESIZE));
+#else
+		return size_t(4096);
+#endif
+	}();
+	return pageSize;
+}
+
+void* VirtualMemory::Reserve(size_t size)
+{
+#if defined(_WIN32)
+	void* base = VirtualAlloc(nullptr, size, MEM_RESERVE, PAGE_NOACCESS);
+	if (!base)
+	{
+		std::cout << "ERROR: VirtualMemory reserve failed\n";
+		return nullptr;
+	}
+	return base;
+#elif defined(__linux__)
+	void* base = mmap(nullptr, size, PROT_READ | PROT_WRITE,
+		MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+	if (base == MAP_FAILED)
+	{
+		std::cout << "ERROR: VirtualMemory reserve failed\n";
+		return nullptr;
+	}
+	return base;
+#else
+	return nullptr;
+#endif
+}
+
+bool VirtualMemory::Commit(void* ptr, size_t size)
+{
+#if defined(_WIN32)
+	if (!VirtualAlloc(ptr, size, MEM_COMMIT, PAGE_READWRITE))
+	{
+		std::cout << "ERROR: VirtualMemory commit failed\n";
+		return false;
+	}
+	return true;
+#else
+	//Already mapped read/write, the kernel backs pages on first touch
+	(void)ptr;
+	(void)size;
+	return true;
+#endif
+}
+
+void VirtualMemory::Decommit(void* ptr, size_t size)
+{
+#if defined(_WIN32)
+	VirtualFree(ptr, size, MEM_DECOMMIT);
+#elif defined(__linux__)
+	madvise(ptr, size, MADV_DONTNEED);
+#endif
+}
+
+bool VirtualMemory::Protect(void* ptr, size_t size, bool readWrite)
+{
+#if defined(_WIN32)
+	DWORD oldProtect = 0;
+	return VirtualProtect(ptr, size, readWrite ? PAGE_READWRITE : PAGE_NOACCESS, &oldProtect) != 0;
+#elif defined(__linux__)
+	return mprotect(ptr, size, readWrite ? (PROT_READ | PROT_WRITE) : PROT_NONE) == 0;
+#else
+	(void)ptr;
+	(void)size;
+	(void)readWrite;
+	return false;
+#endif
+}
+
+void VirtualMemory::Release(void* ptr, size_t size)
+{
+	if (!ptr) return;
+#if defined(_WIN32)
+	(void)size;
+	VirtualFree(ptr, 0, MEM_RELEASE);
+#elif defined(__linux__)
+	munmap(ptr, size);
+#endif
+}
@@ -0,0 +1,25 @@
+#pragma once
+#include <cstddef>
+
+enum class ArenaBacking
+{
+	Heap,			// malloc the whole capacity up front
+	VirtualMemory	// reserve address space, commit pages as they are used
+};
+
+/*
+* Thin wrapper over the OS virtual memory calls.
+* On Windows reserve/commit map to MEM_RESERVE/MEM_COMMIT.
+* On Linux the range is mapped MAP_NORESERVE so pages only get backed when first touched,
+* Commit is therefore free and Decommit gives the pages back with MADV_DONTNEED.
+*/
+namespace VirtualMemory
+{
+	size_t GetPageSize();
+
+	void* Reserve(size_t size);
+	bool Commit(void* ptr, size_t size);
+	void Decommit(void* ptr, size_t size);
+	bool Protect(void* ptr, size_t size, bool readWrite);	//committed pages only, false = no access
+	void Release(void* ptr, size_t size);
+}
@@ -2,7 +2,7 @@
 
 void Projectile::Init(float x, float y, float z, float dirX, float dirY, float dirZ,
     float speed, float lifetime,
-    const std::string& meshGUID, const std::string& textureGUID)
+    AssetId meshGUID, AssetId textureGUID)
 {
     m_posX = x;
     m_posY = y;
@@ -1,6 +1,6 @@
 #pragma once
 #include <cmath>
-#include <string>
+#include "AssetManager/AssetId.hpp"
 
 class Projectile
 {
@@ -9,7 +9,7 @@ public:
 
     void Init(float x, float y, float z, float dirX, float dirY, float dirZ,
         float speed, float lifetime,
-        const std::string& meshGUID, const std::string& textureGUID);
+        AssetId meshGUID, AssetId textureGUID);
 
     void Update(float dt);
 
@@ -22,8 +22,8 @@ public:
     float GetDirY() const { return m_dirY; }
     float GetDirZ() const { return m_dirZ; }
 
-    const std::string& GetMeshGUID() const { return m_meshGUID; }
-    const std::string& GetTextureGUID() const { return m_textureGUID; }
+    AssetId GetMeshGUID() const { return m_meshGUID; }
+    AssetId GetTextureGUID() const { return m_textureGUID; }
 
 
 private:
@@ -36,6 +36,6 @@ private:
     float m_speed = 0.0f;
     float m_lifetime = 0.0f;
     bool m_alive = false;
-    std::string m_meshGUID;
-    std::string m_textureGUID;
+    AssetId m_meshGUID;
+    AssetId m_textureGUID;
 };
\ No newline at end of file
@@ -1,51 +1,34 @@
 #include "ProjectileManager.hpp"
 
-void ProjectileManager::Initialize(size_t maxProjectiles)
+void ProjectileManager::Initialize(size_t projectileCapacity)
 {
-    InitPool(sizeof(Projectile), maxProjectiles, alignof(Projectile));
-    m_projectiles.reserve(maxProjectiles);
-    m_freeProjectiles.reserve(maxProjectiles);
+    //The pool still grows past this, reserving just avoids the first reallocations
+    m_projectiles.Reserve(projectileCapacity);
 }
 
-Projectile* ProjectileManager::Create(float x, float y, float z,
+ProjectileHandle ProjectileManager::Create(float x, float y, float z,
     float dx, float dy, float dz,
     float speed, float lifetime,
-    const std::string& meshGUID,
-    const std::string& textureGUID)
+    AssetId meshGUID,
+    AssetId textureGUID)
 {
-    Projectile* proj = nullptr;
-
-    if (!m_freeProjectiles.empty())
-    {
-        proj = m_freeProjectiles.back();
-        m_freeProjectiles.pop_back();
-        proj->Init(x, y, z, dx, dy, dz, speed, lifetime, meshGUID, textureGUID);
-    }
-    else
-    {
-        void* mem = PoolAlloc();
-        if (!mem) return nullptr;
-
-        proj = new(mem) Projectile();
+    ProjectileHandle handle = m_projectiles.Create();
+    if (Projectile* proj = m_projectiles.Get(handle))
         proj->Init(x, y, z, dx, dy, dz, speed, lifetime, meshGUID, textureGUID);
-    }
-
-    m_projectiles.push_back(proj);
-    return proj;
+    return handle;
 }
 
 void ProjectileManager::Update(float dt)
 {
-    for (size_t i = 0; i < m_projectiles.size(); )
+    for (size_t i = 0; i < m_projectiles.Size(); )
     {
-        Projectile* p = m_projectiles[i];
-        p->Update(dt);
+        Projectile& p = m_projectiles[i];
+        p.Update(dt);
 
-        if (!p->IsAlive())
+        if (!p.IsAlive())
         {
-            m_freeProjectiles.push_back(p);
-            m_projectiles[i] = m_projectiles.back();
-            m_projectiles.pop_back();
+            //Destroy moves the last projectile into slot i, so i is checked again
+            m_projectiles.Destroy(m_projectiles.GetHandleAt(i));
         }
         else
         {
@@ -56,14 +39,5 @@ void ProjectileManager::Update(float dt)
 
 void ProjectileManager::Shutdown()
 {
-    for (Projectile* p : m_projectiles)
-        p->~Projectile();
-
-    for (Projectile* p : m_freeProjectiles)
-        p->~Projectile();
-
-    ShutdownMemory();
-
-    m_projectiles.clear();
-    m_freeProjectiles.clear();
+    m_projectiles.Clear();
 }
\ No newline at end of file
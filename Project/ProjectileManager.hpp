@@ -1,25 +1,31 @@
 #pragma once
 #include "Projectile.hpp"
-#include "MemoryManager/Memory.hpp"
-#include <vector>
-#include <string>
+#include "MemoryManager/HandlePool.hpp"
+#include <memory_resource>
+
+using ProjectileHandle = Handle<Projectile>;
 
 class ProjectileManager
 {
 public:
-    void Initialize(size_t maxProjectiles);
+    explicit ProjectileManager(std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+        : m_projectiles(resource) {}
+
+    void Initialize(size_t projectileCapacity);
 
-    Projectile* Create(float x, float y, float z,
+    ProjectileHandle Create(float x, float y, float z,
         float dx, float dy, float dz,
         float speed, float lifetime,
-        const std::string& meshGUID, const std::string& textureGUID);
+        AssetId meshGUID, AssetId textureGUID);
+
+    // nullptr once the projectile has expired
+    Projectile* Get(ProjectileHandle handle) { return m_projectiles.Get(handle); }
 
     void Update(float dt);
     void Shutdown();
 
-    const std::vector<Projectile*>& GetProjectiles() const { return m_projectiles; }
+    const HandlePool<Projectile>& GetProjectiles() const { return m_projectiles; }
 
 private:
-    std::vector<Projectile*> m_projectiles;
-    std::vector<Projectile*> m_freeProjectiles;
+    HandlePool<Projectile> m_projectiles;
 };
\ No newline at end of file
@@ -11,14 +11,15 @@ ProjectileRenderer::~ProjectileRenderer()
 }
 
 ProjectileRenderer::ProjectileAsset& ProjectileRenderer::GetOrLoadAsset(
-    const std::string& meshGUID, const std::string& textureGUID)
+    AssetId meshGUID, AssetId textureGUID)
 {
-    std::string key = meshGUID + "_" + textureGUID;
-    auto& asset = m_projectileAssets[key];
+    auto& asset = m_projectileAssets[AssetKey{ meshGUID, textureGUID }];
 
     if (!asset.isLoaded)
     {
-        asset.modelName = "projectile_" + key;
+        //Only built once per mesh and texture pair, the model needs a name of its own in RaylibHelper
+        asset.modelName = "projectile_" + meshGUID.GetDebugName() + "_" + textureGUID.GetDebugName();
+        asset.textureGUID = textureGUID;
 
         asset.model = m_raylibHelper->GetModel(meshGUID, asset.modelName);
         asset.texture = m_raylibHelper->GetTexture(textureGUID);
@@ -44,17 +45,17 @@ void ProjectileRenderer::RenderProjectiles(const ProjectileManager& projectileMa
 
     // Render all projectiles
     const auto& projectiles = projectileManager.GetProjectiles();
-    for (const Projectile* proj : projectiles)
+    for (const Projectile& proj : projectiles)
     {
-        if (!proj->IsAlive()) continue;
+        if (!proj.IsAlive()) continue;
 
-        auto& asset = GetOrLoadAsset(proj->GetMeshGUID(), proj->GetTextureGUID());
+        auto& asset = GetOrLoadAsset(proj.GetMeshGUID(), proj.GetTextureGUID());
         asset.refCount++;
 
         Vector3 position = {
-            proj->GetPosX(),
-            proj->GetPosY(),
-            proj->GetPosZ()
+            proj.GetPosX(),
+            proj.GetPosY(),
+            proj.GetPosZ()
         };
 
         DrawModel(asset.model, position, 0.3f, WHITE);
@@ -68,11 +69,7 @@ void ProjectileRenderer::CleanupUnusedAssets()
         if (it->second.refCount == 0)
         {
             m_raylibHelper->ReleaseModel(it->second.modelName);
-            const size_t sep = it->first.find('_');
-
-            const std::string textureGuid = (sep == std::string::npos) ? it->first : it->first.substr(sep + 1);
-
-            m_raylibHelper->ReleaseTexture(textureGuid);
+            m_raylibHelper->ReleaseTexture(it->second.textureGUID);
 
             it = m_projectileAssets.erase(it);
         }
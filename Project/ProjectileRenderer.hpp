@@ -3,7 +3,6 @@
 #include "RaylibHelper.hpp"
 #include "raylib.h"
 #include <unordered_map>
-#include <string>
 
 class ProjectileRenderer
 {
@@ -21,12 +20,30 @@ private:
         Texture2D texture;
         int refCount = 0;
         bool isLoaded = false;
-        std::string modelName;
+        AssetId modelName;
+        AssetId textureGUID;
+    };
+
+    struct AssetKey
+    {
+        AssetId mesh;
+        AssetId texture;
+
+        bool operator==(const AssetKey& other) const { return mesh == other.mesh && texture == other.texture; }
+    };
+
+    struct AssetKeyHash
+    {
+        size_t operator()(const AssetKey& key) const
+        {
+            return std::hash<AssetId>()(key.mesh) ^ (std::hash<AssetId>()(key.texture) * 31);
+        }
     };
 
     RaylibHelper* m_raylibHelper;
-    std::unordered_map<std::string, ProjectileAsset> m_projectileAssets;
+    // Looked up for every projectile every frame, so only ids are hashed
+    std::unordered_map<AssetKey, ProjectileAsset, AssetKeyHash> m_projectileAssets;
 
-    ProjectileAsset& GetOrLoadAsset(const std::string& meshGUID, const std::string& textureGUID);
+    ProjectileAsset& GetOrLoadAsset(AssetId meshGUID, AssetId textureGUID);
 };
 
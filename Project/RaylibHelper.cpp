@@ -1,6 +1,7 @@
 #include "RaylibHelper.hpp"
 
-RaylibHelper::RaylibHelper(AssetManager& assetManager)
+RaylibHelper::RaylibHelper(AssetManager& assetManager, std::pmr::memory_resource* resource)
+    : m_textures(resource), m_models(resource), m_progressiveLODs(resource)
 {
     m_baseTexture = GenerateBaseTexture();
     m_baseModel = GenerateBaseModel();
@@ -14,9 +15,9 @@ RaylibHelper::~RaylibHelper()
     UnloadTexture(m_baseTexture);
 }
 
-Texture2D RaylibHelper::GetTexture(std::string GUID)
+Texture2D RaylibHelper::GetTexture(AssetId GUID)
 {
-	m_assetManager->LoadAsync(GUID);
+	m_assetManager->LoadAsync(GUID, LoadPriority::Visible);
 	auto& entry = m_textures[GUID];
 
 	if (entry.refCount == 0)
@@ -27,15 +28,17 @@ Texture2D RaylibHelper::GetTexture(std::string GUID)
             return m_baseTexture;
 		}
 		entry.texture = GenerateTexture(res);
+		//Kept resident while a texture made from it is handed out
+		m_assetManager->Pin(GUID);
 	}
 
 	entry.refCount++;
 	return entry.texture;
 }
 
-Model RaylibHelper::GetModel(std::string GUID, std::string name)
+Model RaylibHelper::GetModel(AssetId GUID, AssetId name)
 {
-    m_assetManager->LoadAsync(GUID);
+    m_assetManager->LoadAsync(GUID, LoadPriority::Visible);
     auto& entry = m_models[name];
 
     if (entry.refCount == 0)
@@ -52,13 +55,14 @@ Model RaylibHelper::GetModel(std::string GUID, std::string name)
         auto mesh = std::dynamic_pointer_cast<MeshObj>(res);
         entry.guid = GUID;
         entry.model = ConvertAttribToModel(mesh->GetAttrib(), mesh->GetShapes());
+        m_assetManager->Pin(GUID);
     }
 
     entry.refCount++;
     return entry.model;
 }
 
-void RaylibHelper::ReleaseTexture(std::string GUID)
+void RaylibHelper::ReleaseTexture(AssetId GUID)
 {
     auto it = m_textures.find(GUID);
     if (it == m_textures.end())
@@ -70,11 +74,12 @@ void RaylibHelper::ReleaseTexture(std::string GUID)
     {
         UnloadTexture(it->second.texture);
         m_textures.erase(it);
+        m_assetManager->Unpin(GUID);
         m_assetManager->Unload(GUID); //maybe
     }
 }
 
-void RaylibHelper::ReleaseModel(std::string name)
+void RaylibHelper::ReleaseModel(AssetId name)
 {
     auto it = m_models.find(name);
     if (it == m_models.end())
@@ -85,6 +90,7 @@ void RaylibHelper::ReleaseModel(std::string name)
     if (--it->second.refCount == 0)
     {
         UnloadModel(it->second.model);
+        m_assetManager->Unpin(it->second.guid);
         m_assetManager->Unload(it->second.guid); //maybe (yes)
         m_models.erase(it);
 
@@ -92,7 +98,7 @@ void RaylibHelper::ReleaseModel(std::string name)
 }
 
 
-void RaylibHelper::ForceUnloadTexture(std::string GUID)
+void RaylibHelper::ForceUnloadTexture(AssetId GUID)
 {
     auto it = m_textures.find(GUID);
     if (it == m_textures.end())
@@ -101,11 +107,13 @@ void RaylibHelper::ForceUnloadTexture(std::string GUID)
     }
 
     UnloadTexture(it->second.texture);
+    if (it->second.refCount > 0)
+        m_assetManager->Unpin(GUID);
     m_textures.erase(it);
     m_assetManager->Unload(GUID); //maybe
 }
 
-void RaylibHelper::ForceUnloadModel(std::string name)
+void RaylibHelper::ForceUnloadModel(AssetId name)
 {
     auto it = m_models.find(name);
     if (it == m_models.end())
@@ -114,6 +122,8 @@ void RaylibHelper::ForceUnloadModel(std::string name)
     }
 
     UnloadModel(it->second.model);
+    if (it->second.refCount > 0)
+        m_assetManager->Unpin(it->second.guid);
     m_assetManager->Unload(it->second.guid); //maybe (yes)
     m_models.erase(it);
 
@@ -125,12 +135,16 @@ void RaylibHelper::CleanUp()
 	for (auto& it : m_models)
 	{
 		UnloadModel(it.second.model);
+		if (it.second.refCount > 0)
+			m_assetManager->Unpin(it.second.guid);
 	}
 
 	//Unload all textures
 	for (auto& it : m_textures)
 	{
 		UnloadTexture(it.second.texture);
+		if (it.second.refCount > 0)
+			m_assetManager->Unpin(it.first);
 	}
 
 	m_models.clear();
@@ -166,7 +180,7 @@ Texture2D RaylibHelper::GenerateTexture(std::shared_ptr<IResource>& baseRes)
             img.format = PIXELFORMAT_UNCOMPRESSED_R8G8B8A8;
             texture = LoadTextureFromImage(img);
 
-            UnloadImage(img);
+            //The pixels belong to the resource, TexturePng::Unload frees them
             return texture;
         }
     }
@@ -217,7 +231,7 @@ Model RaylibHelper::GenerateBaseModel()
     return model;
 }
 
-void RaylibHelper::RequestProgressiveTexture(const std::string& baseGuid, int maxLOD)
+void RaylibHelper::RequestProgressiveTexture(AssetId baseGuid, int maxLOD)
 {
     ProgressiveLODState& state = m_progressiveLODs[baseGuid];
     state.baseGuid = baseGuid;
@@ -225,8 +239,8 @@ void RaylibHelper::RequestProgressiveTexture(const std::string& baseGuid, int ma
     state.delay = 2.0f;
     state.maxLOD = maxLOD;
     state.active = true;
-    state.nextGuid.clear();
-    state.pendingUnload.clear();
+    state.nextGuid = AssetId();
+    state.pendingUnload = AssetId();
 
     m_assetManager->LoadAsync(baseGuid);
 
@@ -254,7 +268,7 @@ void RaylibHelper::Update(float dt)
         if (!baseTex)
             continue;
 
-        if (state.nextGuid.empty())
+        if (!state.nextGuid.IsValid())
         {
             baseTex->SetLODInfo(state.maxLOD);
 
@@ -311,10 +325,13 @@ void RaylibHelper::Update(float dt)
             state.active = false;
         }
 
-        if (!state.pendingUnload.empty())
+        if (state.pendingUnload.IsValid())
         {
+            //Unload keeps anything still referenced, drop ours first
+            nextTex.reset();
+            nextRes.reset();
             m_assetManager->Unload(state.pendingUnload);
-            state.pendingUnload.clear();
+            state.pendingUnload = AssetId();
         }
     }
 }
@@ -2,6 +2,7 @@
 #include <iostream>
 #include <vector>
 #include <unordered_map>
+#include <memory_resource>
 
 #include "AssetManager/AssetManager.hpp"
 #include "AssetManager/TexturePngResource.hpp"
@@ -19,27 +20,28 @@ struct TextureEntry
 struct ModelEntry
 {
 	Model model;
-	std::string guid;
+	AssetId guid;
 	int refCount = 0;
 };
 
 class RaylibHelper
 {
 public:
-	RaylibHelper(AssetManager& assetManager);
+	RaylibHelper(AssetManager& assetManager, std::pmr::memory_resource* resource = std::pmr::get_default_resource());
 	~RaylibHelper();
 
-	Texture2D GetTexture(std::string GUID);
-	Model GetModel(std::string GUID, std::string name);
+	// Models are cached per name, so the same mesh can be used by several models with their own materials
+	Texture2D GetTexture(AssetId GUID);
+	Model GetModel(AssetId GUID, AssetId name);
 
-	void ReleaseTexture(std::string GUID);
-	void ReleaseModel(std::string name);
+	void ReleaseTexture(AssetId GUID);
+	void ReleaseModel(AssetId name);
 
 
-	void ForceUnloadTexture(std::string GUID);
-	void ForceUnloadModel(std::string name);
+	void ForceUnloadTexture(AssetId GUID);
+	void ForceUnloadModel(AssetId name);
 
-	void RequestProgressiveTexture(const std::string& baseGuid, int maxLOD);
+	void RequestProgressiveTexture(AssetId baseGuid, int maxLOD);
 	void Update(float dt);
 	void CleanUp();
 
@@ -48,14 +50,14 @@ private:
 	Texture2D GenerateBaseTexture();
 	Model GenerateBaseModel();
 
-	std::unordered_map<std::string, TextureEntry> m_textures;
-	std::unordered_map<std::string, ModelEntry> m_models;
+	std::pmr::unordered_map<AssetId, TextureEntry> m_textures;
+	std::pmr::unordered_map<AssetId, ModelEntry> m_models;
 
 	struct ProgressiveLODState
 	{
-		std::string baseGuid;
-		std::string nextGuid;
-		std::string pendingUnload;
+		AssetId baseGuid;
+		AssetId nextGuid;
+		AssetId pendingUnload;
 
 		float timer = 0.0f;
 		float delay = 2.0f;
@@ -64,7 +66,7 @@ private:
 		bool active = false;
 	};
 
-	std::unordered_map<std::string, ProgressiveLODState> m_progressiveLODs;
+	std::pmr::unordered_map<AssetId, ProgressiveLODState> m_progressiveLODs;
 
 	Texture2D m_baseTexture;
 	Model m_baseModel;
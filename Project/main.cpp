@@ -2,7 +2,10 @@
 #include "RaylibHelper.hpp"
 #include "ProjectileManager.hpp"
 #include "ProjectileRenderer.hpp"
-#include "MemoryManager/StackAllocator.hpp"
+#include "MemoryManager/FrameAllocator.hpp"
+#include "MemoryManager/Memory.hpp"
+#include "MemoryManager/MemoryResources.hpp"
+#include "MemoryManager/MemoryTrace.hpp"
 #include "ExplosionSystem.hpp"
 #include "raymath.h"
 #include "raylib.h"
@@ -11,6 +14,7 @@
 #include <memory>
 #include <unordered_map>
 #include <unordered_set>
+#include <memory_resource>
 
 struct MemoryDebugInfo 
 {
@@ -25,19 +29,20 @@ struct AssetDebugInfo
     size_t memoryLimitBytes = 0;
     size_t loadedResourceCount = 0;
     size_t asyncJobsInFlight = 0;
+    size_t ioQueueDepth = 0;
     size_t totalEvictions = 0;
 };
 
 struct PendingTextureSet
 {
-    std::string guid;
+    AssetId guid;
     Model* model = nullptr;
     bool applied = false;
 };
 
 struct PendingModelSet
 {
-    std::string guid;
+    AssetId guid;
     std::string name;
     Model* outModel = nullptr;
     bool applied = false;
@@ -130,9 +135,10 @@ void DrawAssetManagerOverlay(const AssetDebugInfo info)
 
     // Loaded resources and async jobs
     std::snprintf(buffer, sizeof(buffer),
-        "Loaded: %zu | Jobs: %zu",
+        "Loaded: %zu | Jobs: %zu | IO queue: %zu",
         info.loadedResourceCount,
-        info.asyncJobsInFlight);
+        info.asyncJobsInFlight,
+        info.ioQueueDepth);
     DrawText(buffer, panelX + 10, panelY + 55, 14, RAYWHITE);
 
     // Optional evictions line
@@ -148,12 +154,25 @@ int main()
     PackagingTool packagingTool;
     packagingTool.buildPackage("AssetsListNew.txt", "Assets.bundle");
 
+    //Engine heap, subsystem containers live here instead of the global heap.
+    //The pool resource in front recycles small nodes and makes it safe for the asset worker thread
+    BuddyAllocator engineHeap(64, 8 * 1024 * 1024, ArenaBacking::VirtualMemory);
+    BuddyResource engineHeapResource(engineHeap);
+    std::pmr::synchronized_pool_resource engineResource(&engineHeapResource);
+    //A few container allocations go to guarded pages instead, so heap overflows and use-after-free fault where they happen
+    InitGuardedSampling();
+    GuardedSamplingResource sampledEngineResource(&engineResource, MemoryTag::Buddy);
+
+    //Texture pixel buffers, sized above the asset manager budget so streaming never runs it dry
+    InitTlsf(64 * 1024 * 1024, ArenaBacking::VirtualMemory);
+
     //Asset manager
-    AssetManager am(32 * 1024 * 1024, "Assets.bundle");
+    AssetManager am(32 * 1024 * 1024, "Assets.bundle", &sampledEngineResource);
     AssetDebugInfo g_assetsDebug;
 
-    StackAllocator frameAllocator(64 * 1024);  
-    ExplosionSystem explosionSystem(frameAllocator);
+    // Double buffered so frame data can be consumed while the next frame is simulated
+    FrameAllocator frameAllocator(2, 64 * 1024);
+    ExplosionSystem explosionSystem(frameAllocator, &sampledEngineResource);
     MemoryDebugInfo g_memoryDebug;
 
     int width = 1280;
@@ -163,7 +182,7 @@ int main()
     DisableCursor();
 
     //Raylib helper
-    RaylibHelper rh(am);
+    RaylibHelper rh(am, &sampledEngineResource);
     
     //Dynamic model using GUID (Texture isnt set here, it is set when fully loaded)
     am.Load("cube");
@@ -195,15 +214,16 @@ int main()
     camera.projection = CAMERA_PERSPECTIVE;
 
     //PROJECTILE SYSTEM
-    ProjectileManager projectileManager;
+    ProjectileManager projectileManager(&sampledEngineResource);
     projectileManager.Initialize(1000);
 
     ProjectileRenderer projectileRenderer(rh);
 
-    std::string currentProjectileMesh = "sphere";
-    std::string currentProjectileTexture = "001";
+    AssetId currentProjectileMesh = "sphere";
+    AssetId currentProjectileTexture = "001";
 
     float shootCooldown = 0.0f;
+    float poolTrimTimer = 0.0f;
 
     //STRESS loader
     static bool stressOn = false;
@@ -215,6 +235,9 @@ int main()
     static int guidMax = 200;
     static int guidCursor = guidMin;
 
+    //Requested models and textures jump the queue, and are due within half a second
+    const uint64_t visibleLoadDeadline = 30;
+
     auto NextGuid = [&]()
     {
         std::string g = std::to_string(guidCursor++);
@@ -224,14 +247,14 @@ int main()
 
 
     std::unordered_map<std::string, PendingTextureSet> pendingByName;
-    std::unordered_set<std::string> pendingGuids;
+    std::unordered_set<AssetId> pendingGuids;
     std::unordered_map<std::string, PendingModelSet> pendingModelsByName;
-    std::unordered_set<std::string> pendingModelGuids;
+    std::unordered_set<AssetId> pendingModelGuids;
 
-    auto RequestTextureFor = [&](const std::string& name, Model& model, const std::string& guid)
+    auto RequestTextureFor = [&](const std::string& name, Model& model, AssetId guid)
     {
         pendingByName[name] = PendingTextureSet{ guid, &model, false };
-        am.LoadAsync(guid);
+        am.LoadAsync(guid, LoadPriority::Visible, am.GetFrame() + visibleLoadDeadline);
         pendingGuids.insert(guid);
     };
 
@@ -239,7 +262,7 @@ int main()
     {
         for (auto it = pendingGuids.begin(); it != pendingGuids.end(); )
         {
-            const std::string& guid = *it;
+            AssetId guid = *it;
 
             if (am.TryGet(guid) == nullptr)
             {
@@ -261,10 +284,10 @@ int main()
         }
     };
 
-    auto RequestModelFor = [&](const std::string& name, Model& model, const std::string& guid)
+    auto RequestModelFor = [&](const std::string& name, Model& model, AssetId guid)
     {
         pendingModelsByName[name] = PendingModelSet{ guid, name, &model, false };
-        am.LoadAsync(guid);
+        am.LoadAsync(guid, LoadPriority::Visible, am.GetFrame() + visibleLoadDeadline);
         pendingModelGuids.insert(guid);
     };
 
@@ -272,7 +295,7 @@ int main()
     {
         for (auto it = pendingModelGuids.begin(); it != pendingModelGuids.end(); )
         {
-            const std::string& guid = *it;
+            AssetId guid = *it;
 
             if (am.TryGet(guid) == nullptr) { ++it; continue; } // not ready
 
@@ -307,7 +330,8 @@ int main()
         ResolvePendingModels();
         ResolvePendingTextures();
 
-        frameAllocator.Reset();
+        uint64_t frame = frameAllocator.BeginFrame();
+        am.BeginFrame(frame);
         explosionSystem.Update(dt);
 
 
@@ -321,17 +345,20 @@ int main()
         }
 
         explosionSystem.BuildRendererData();
+        frameAllocator.EndFrame();
+
         AssetManagerDebugInfo amInfo{};
         am.GetDebugInfo(amInfo);
 
-        g_memoryDebug.stackUsedBytes = frameAllocator.GetUsed();
-        g_memoryDebug.stackCapacityBytes = frameAllocator.GetCapacity();
-        g_memoryDebug.stackUsageRatio = frameAllocator.GetUsageRatio();
+        g_memoryDebug.stackUsedBytes = frameAllocator.Current().GetUsed();
+        g_memoryDebug.stackCapacityBytes = frameAllocator.Current().GetCapacity();
+        g_memoryDebug.stackUsageRatio = frameAllocator.Current().GetUsageRatio();
 
         g_assetsDebug.memoryLimitBytes = amInfo.memoryLimit;
         g_assetsDebug.memoryUsedBytes = amInfo.memoryUsed;
         g_assetsDebug.loadedResourceCount = amInfo.loadedResourceCount;
         g_assetsDebug.asyncJobsInFlight = amInfo.asyncQueuedJobs + amInfo.asyncActiveJobs;
+        g_assetsDebug.ioQueueDepth = amInfo.ioQueueDepth;
         g_assetsDebug.totalEvictions = amInfo.totalEvictions;
 
         BeginDrawing();
@@ -383,7 +410,7 @@ int main()
         if (IsKeyPressed(KEY_FIVE))
         {
             for (int i = 0; i < stressLoadsPerTick; ++i)
-                am.LoadAsync(NextGuid());
+                am.LoadAsync(NextGuid(), LoadPriority::Background);
         }
 
         //PROJECTILES
@@ -422,6 +449,23 @@ int main()
         // Update projectiles
         projectileManager.Update(dt);
 
+        // Let the small object pools shrink back after bursts
+        poolTrimTimer += dt;
+        if (poolTrimTimer >= 5.0f)
+        {
+            SmallTrim();
+            poolTrimTimer = 0.0f;
+        }
+
+        //Record allocator traffic for the allocator benchmark (Benchmarks allocators --trace memory.trace)
+        if (IsKeyPressed(KEY_F9))
+        {
+            if (IsMemoryTraceRunning())
+                StopMemoryTrace("memory.trace");
+            else
+                StartMemoryTrace();
+        }
+
         if (IsKeyPressed(KEY_P))
         {
             rh.RequestProgressiveTexture("004_lod0", 2);
@@ -493,6 +537,9 @@ int main()
         DrawAssetManagerOverlay(g_assetsDebug);
 
         EndDrawing();
+
+        // Rendering consumed this frame's data, its buffer can be reused
+        frameAllocator.ReleaseFrame(frame);
     }
     
     projectileManager.Shutdown();